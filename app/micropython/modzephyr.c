@@ -37,6 +37,17 @@
 
 #include "modzephyr.h"
 #include "py/runtime.h"
+#include "py/mphal.h"
+
+#ifdef CONFIG_VIDEO_MOTION
+#include <app/vmotion.h>
+#endif
+
+#ifdef CONFIG_VIDEO_CAMERA
+#include <zephyr/drivers/video.h>
+#include <app/camera.h>
+#include <errno.h>
+#endif
 
 static mp_obj_t mod_is_preempt_thread(void) {
     return mp_obj_new_bool(k_is_preempt_thread());
@@ -70,6 +81,119 @@ static mp_obj_t mod_shell_exec(mp_obj_t cmd_in) {
 static MP_DEFINE_CONST_FUN_OBJ_1(mod_shell_exec_obj, mod_shell_exec);
 #endif // CONFIG_SHELL_BACKEND_SERIAL
 
+#ifdef CONFIG_VIDEO_MOTION
+// events already returned by motion()
+static uint32_t motion_seen;
+
+// motion(timeout_ms=0): (timestamp, blocks, total) of the latest motion event
+// not yet returned, or None if there was none within the timeout
+static mp_obj_t mod_motion(size_t n_args, const mp_obj_t *args) {
+    mp_int_t timeout_ms = n_args > 0 ? mp_obj_get_int(args[0]) : 0;
+    mp_uint_t t0 = mp_hal_ticks_ms();
+    struct vmotion_event event;
+    int err;
+
+    // wait in slices so KeyboardInterrupt and other threads still run
+    do {
+        mp_uint_t dt = mp_hal_ticks_ms() - t0;
+        mp_int_t slice = timeout_ms < 0 ? 50 : MIN(50, timeout_ms - (mp_int_t)dt);
+        MP_THREAD_GIL_EXIT();
+        err = vmotion_wait(&motion_seen, &event, K_MSEC(MAX(slice, 0)));
+        MP_THREAD_GIL_ENTER();
+        if (err == 0) {
+            break;
+        }
+        mp_handle_pending(MP_HANDLE_PENDING_CALLBACKS_AND_EXCEPTIONS);
+    } while ( (timeout_ms < 0 || (mp_int_t)(mp_hal_ticks_ms() - t0) < timeout_ms));
+
+    if (err != 0) {
+        return mp_const_none;
+    }
+    mp_obj_t items[3] = {
+        mp_obj_new_int_from_uint(event.timestamp),
+        MP_OBJ_NEW_SMALL_INT(event.blocks),
+        MP_OBJ_NEW_SMALL_INT(event.total),
+    };
+    return mp_obj_new_tuple(3, items);
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_motion_obj, 0, 1, mod_motion);
+
+static mp_obj_t mod_motion_config(mp_obj_t threshold_in, mp_obj_t blocks_in) {
+    vmotion_config(mp_obj_get_int(threshold_in), mp_obj_get_int(blocks_in));
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(mod_motion_config_obj, mod_motion_config);
+#endif
+
+#ifdef CONFIG_VIDEO_CAMERA
+static mp_obj_t mod_camera_start(void) {
+    MP_THREAD_GIL_EXIT();
+    int err = camera_start();
+    MP_THREAD_GIL_ENTER();
+    if (err != 0 && err != -EALREADY) {
+        mp_raise_OSError(-err);
+    }
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_0(mod_camera_start_obj, mod_camera_start);
+
+static mp_obj_t mod_camera_stop(void) {
+    int err;
+    // waits for the capture thread to release its buffers
+    MP_THREAD_GIL_EXIT();
+    err = camera_stop();
+    MP_THREAD_GIL_ENTER();
+    if (err != 0) {
+        mp_raise_OSError(-err);
+    }
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_0(mod_camera_stop_obj, mod_camera_stop);
+
+static mp_obj_t mod_camera_running(void) {
+    return mp_obj_new_bool(camera_running());
+}
+static MP_DEFINE_CONST_FUN_OBJ_0(mod_camera_running_obj, mod_camera_running);
+
+// camera_config(): (width, height, fourcc)
+// camera_config(width, height[, fourcc]): restarts the capture if it runs
+static mp_obj_t mod_camera_config(size_t n_args, const mp_obj_t *args) {
+    struct camera_config config;
+    int err;
+
+    camera_get_config(&config);
+    if (n_args == 0) {
+        mp_obj_t items[3] = {
+            mp_obj_new_int(config.width),
+            mp_obj_new_int(config.height),
+            mp_obj_new_str((const char *)&config.pixelformat, config.pixelformat ? 4 : 0),
+        };
+        return mp_obj_new_tuple(3, items);
+    }
+    if (n_args < 2) {
+        mp_raise_TypeError(MP_ERROR_TEXT("width and height required"));
+    }
+    config.width = mp_obj_get_int(args[0]);
+    config.height = mp_obj_get_int(args[1]);
+    if (n_args > 2) {
+        size_t len;
+        const char *fourcc = mp_obj_str_get_data(args[2], &len);
+        if (len != 4) {
+            mp_raise_ValueError(MP_ERROR_TEXT("fourcc"));
+        }
+        config.pixelformat = video_fourcc(fourcc[0], fourcc[1], fourcc[2], fourcc[3]);
+    }
+    MP_THREAD_GIL_EXIT();
+    err = camera_reconfigure(&config);
+    MP_THREAD_GIL_ENTER();
+    if (err != 0) {
+        mp_raise_OSError(-err);
+    }
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_camera_config_obj, 0, 3, mod_camera_config);
+#endif
+
 static const mp_rom_map_elem_t mp_module_time_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_zephyr) },
     { MP_ROM_QSTR(MP_QSTR_is_preempt_thread), MP_ROM_PTR(&mod_is_preempt_thread_obj) },
@@ -80,6 +204,20 @@ static const mp_rom_map_elem_t mp_module_time_globals_table[] = {
     #ifdef CONFIG_SHELL_BACKEND_SERIAL
     { MP_ROM_QSTR(MP_QSTR_shell_exec), MP_ROM_PTR(&mod_shell_exec_obj) },
     #endif
+    #ifdef CONFIG_VIDEO_MOTION
+    { MP_ROM_QSTR(MP_QSTR_motion), MP_ROM_PTR(&mod_motion_obj) },
+    { MP_ROM_QSTR(MP_QSTR_motion_config), MP_ROM_PTR(&mod_motion_config_obj) },
+    #endif
+    #ifdef CONFIG_VIDEO_CAMERA
+    { MP_ROM_QSTR(MP_QSTR_camera_start), MP_ROM_PTR(&mod_camera_start_obj) },
+    { MP_ROM_QSTR(MP_QSTR_camera_stop), MP_ROM_PTR(&mod_camera_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_camera_running), MP_ROM_PTR(&mod_camera_running_obj) },
+    { MP_ROM_QSTR(MP_QSTR_camera_config), MP_ROM_PTR(&mod_camera_config_obj) },
+    { MP_ROM_QSTR(MP_QSTR_Camera), MP_ROM_PTR(&zephyr_camera_type) },
+    #endif
+    #ifdef CONFIG_HU_APP_PWMSEQ
+    { MP_ROM_QSTR(MP_QSTR_PWMSequence), MP_ROM_PTR(&zephyr_pwmseq_type) },
+    #endif
     #ifdef CONFIG_DISK_ACCESS
     { MP_ROM_QSTR(MP_QSTR_DiskAccess), MP_ROM_PTR(&zephyr_disk_access_type) },
     #endif
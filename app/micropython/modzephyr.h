@@ -41,4 +41,12 @@ extern const mp_obj_type_t zephyr_flash_area_type;
 extern const mp_obj_type_t zephyr_filesystem_type;
 #endif
 
+#ifdef CONFIG_VIDEO_CAMERA
+extern const mp_obj_type_t zephyr_camera_type;
+#endif
+
+#ifdef CONFIG_HU_APP_PWMSEQ
+extern const mp_obj_type_t zephyr_pwmseq_type;
+#endif
+
 #endif // MICROPY_INCLUDED_ZEPHYR_MODZEPHYR_H
@@ -32,17 +32,33 @@
 #include <zephyr/drivers/sensor.h>
 #include "zephyr_device.h"
 
+#ifdef CONFIG_SENSOR_ASYNC_API
+#include <zephyr/rtio/rtio.h>
+#include "py/binary.h"
+#include "py/mphal.h"
+#endif
+
 #if MICROPY_PY_ZSENSOR
 
 typedef struct _mp_obj_sensor_t {
     mp_obj_base_t base;
     const struct device *dev;
+    #ifdef CONFIG_SENSOR_ASYNC_API
+    // the last driver read of read_batch(), decoded up to fit, for pending_chan
+    uint8_t *read_buf;
+    uint32_t fit;
+    int pending_chan;
+    #endif
 } mp_obj_sensor_t;
 
 static mp_obj_t sensor_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     mp_arg_check_num(n_args, n_kw, 1, 1, false);
     mp_obj_sensor_t *o = mp_obj_malloc(mp_obj_sensor_t, type);
     o->dev = zephyr_device_find(args[0]);
+    #ifdef CONFIG_SENSOR_ASYNC_API
+    o->read_buf = NULL;
+    o->pending_chan = -1;
+    #endif
     return MP_OBJ_FROM_PTR(o);
 }
 
@@ -159,6 +175,195 @@ static mp_obj_t mp_sensor_attr_set(size_t n_args, const mp_obj_t *args) {
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(sensor_attr_set_obj, 4, 5, mp_sensor_attr_set);
 
+#ifdef CONFIG_SENSOR_ASYNC_API
+RTIO_DEFINE(zsensor_rtio, 1, 1);
+
+// a driver read is kept per Sensor, the decoded chunk is shared and the GIL
+// serialises the callers
+#define ZSENSOR_READ_SIZE (512)
+static uint8_t zsensor_decode_buf[256] __aligned(8);
+
+static void sensor_store_ts(mp_buffer_info_t *ts, size_t index, uint64_t timestamp_ns) {
+    uint64_t us = timestamp_ns / 1000;
+    if (ts->typecode == 'q' || ts->typecode == 'Q') {
+        ((uint64_t *)ts->buf)[index] = us;
+    } else {
+        mp_binary_set_val_array_from_int(ts->typecode, ts->buf, index, (mp_int_t)us);
+    }
+}
+
+static void sensor_store_value(mp_buffer_info_t *buf, size_t index, int64_t micros) {
+    #if MICROPY_PY_BUILTINS_FLOAT
+    if (buf->typecode == 'f') {
+        ((float *)buf->buf)[index] = micros / 1000000.0f;
+        return;
+    }
+    #if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_DOUBLE
+    if (buf->typecode == 'd') {
+        ((double *)buf->buf)[index] = micros / 1000000.0;
+        return;
+    }
+    #endif
+    #endif
+    mp_binary_set_val_array_from_int(buf->typecode, buf->buf, index, (mp_int_t)micros);
+}
+
+// decoded frame layouts of a single value channel, told apart by get_size_info()
+enum {
+    SENSOR_LAYOUT_Q31,
+    SENSOR_LAYOUT_BYTE,
+    SENSOR_LAYOUT_UINT64,
+};
+
+BUILD_ASSERT(sizeof(struct sensor_q31_data) != sizeof(struct sensor_byte_data),
+    "q31 and byte frames have the same size");
+
+static int sensor_layout(size_t base_size, size_t frame_size) {
+    if (base_size == sizeof(struct sensor_q31_data) && frame_size == sizeof(struct sensor_q31_sample_data)) {
+        return SENSOR_LAYOUT_Q31;
+    }
+    if (base_size == sizeof(struct sensor_byte_data) && frame_size == sizeof(struct sensor_byte_sample_data)) {
+        return SENSOR_LAYOUT_BYTE;
+    }
+    if (base_size == sizeof(struct sensor_uint64_data) && frame_size == sizeof(struct sensor_uint64_sample_data)) {
+        return SENSOR_LAYOUT_UINT64;
+    }
+    // three axis frames and driver specific ones
+    return -ENOTSUP;
+}
+
+// read_batch(chan, n, buf, ts=None, *, timeout_ms=1000): stores up to n samples of
+// chan into the preallocated array buf (micro units, or float for 'f' arrays) and
+// their timestamps in us into ts. Each driver read returns everything the sensor
+// buffered, so a FIFO sensor fills the batch in a few calls. Samples of a read
+// beyond n are kept and returned first by the next call for the same chan.
+// Returns the number of samples stored, fewer than n on timeout.
+static mp_obj_t sensor_read_batch(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_chan, ARG_n, ARG_buf, ARG_ts, ARG_timeout_ms };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_chan, MP_ARG_REQUIRED | MP_ARG_INT },
+        { MP_QSTR_n, MP_ARG_REQUIRED | MP_ARG_INT },
+        { MP_QSTR_buf, MP_ARG_REQUIRED | MP_ARG_OBJ },
+        { MP_QSTR_ts, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_timeout_ms, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 1000} },
+    };
+    mp_obj_sensor_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_buffer_info_t buf, ts = { .buf = NULL };
+    mp_get_buffer_raise(args[ARG_buf].u_obj, &buf, MP_BUFFER_WRITE);
+    size_t n = MIN((size_t)MAX(args[ARG_n].u_int, 0), buf.len / mp_binary_get_size('@', buf.typecode, NULL));
+    if (args[ARG_ts].u_obj != mp_const_none) {
+        mp_get_buffer_raise(args[ARG_ts].u_obj, &ts, MP_BUFFER_WRITE);
+        n = MIN(n, ts.len / mp_binary_get_size('@', ts.typecode, NULL));
+    }
+
+    int chan = args[ARG_chan].u_int;
+    if (chan == SENSOR_CHAN_ACCEL_XYZ || chan == SENSOR_CHAN_GYRO_XYZ || chan == SENSOR_CHAN_MAGN_XYZ) {
+        mp_raise_ValueError(MP_ERROR_TEXT("read the axes one at a time"));
+    }
+
+    struct sensor_chan_spec spec = { .chan_type = chan, .chan_idx = 0 };
+    struct sensor_read_config cfg = {
+        .sensor = self->dev,
+        .is_streaming = false,
+        .channels = &spec,
+        .count = 1,
+        .max = 1,
+    };
+    struct rtio_iodev iodev = { .api = &__sensor_iodev_api, .data = &cfg };
+    const struct sensor_decoder_api *decoder;
+    size_t base_size, frame_size;
+    int layout = -ENOTSUP;
+
+    int st = sensor_get_decoder(self->dev, &decoder);
+    if (st == 0) {
+        st = decoder->get_size_info(spec, &base_size, &frame_size);
+    }
+    if (st == 0) {
+        st = layout = sensor_layout(base_size, frame_size);
+    }
+    if (st < 0) {
+        mp_raise_OSError(-st);
+    }
+    uint16_t chunk = (sizeof(zsensor_decode_buf) - base_size) / frame_size + 1;
+
+    if (self->read_buf == NULL) {
+        // m_new keeps the 8 byte alignment of the GC heap
+        self->read_buf = m_new(uint8_t, ZSENSOR_READ_SIZE);
+    }
+
+    size_t got = 0;
+    mp_uint_t t0 = mp_hal_ticks_ms();
+    while (got < n) {
+        size_t before = got;
+        // samples left from the last call go first, a new chan drops them
+        bool fresh = self->pending_chan != chan;
+        if (fresh) {
+            self->pending_chan = -1;
+            st = sensor_read(&iodev, &zsensor_rtio, self->read_buf, ZSENSOR_READ_SIZE);
+            if (st != 0) {
+                mp_raise_OSError(-st);
+            }
+            self->fit = 0;
+            self->pending_chan = chan;
+        }
+
+        int frames = 0;
+        while (got < n && (frames = decoder->decode(self->read_buf, spec, &self->fit,
+            MIN(chunk, n - got), zsensor_decode_buf)) > 0) {
+            if (layout == SENSOR_LAYOUT_BYTE) {
+                const struct sensor_byte_data *data = (const void *)zsensor_decode_buf;
+                for (int i = 0; i < frames; i++, got++) {
+                    sensor_store_value(&buf, got, data->readings[i].is_near * 1000000LL);
+                    if (ts.buf != NULL) {
+                        sensor_store_ts(&ts, got, data->header.base_timestamp_ns + data->readings[i].timestamp_delta);
+                    }
+                }
+            } else if (layout == SENSOR_LAYOUT_UINT64) {
+                const struct sensor_uint64_data *data = (const void *)zsensor_decode_buf;
+                for (int i = 0; i < frames; i++, got++) {
+                    sensor_store_value(&buf, got, (int64_t)data->readings[i].value * 1000000);
+                    if (ts.buf != NULL) {
+                        sensor_store_ts(&ts, got, data->header.base_timestamp_ns + data->readings[i].timestamp_delta);
+                    }
+                }
+            } else {
+                const struct sensor_q31_data *data = (const void *)zsensor_decode_buf;
+                for (int i = 0; i < frames; i++, got++) {
+                    int64_t v = (int64_t)data->readings[i].value * 1000000;
+                    sensor_store_value(&buf, got, data->shift < 31 ? v >> (31 - data->shift) : v << (data->shift - 31));
+                    if (ts.buf != NULL) {
+                        sensor_store_ts(&ts, got, data->header.base_timestamp_ns + data->readings[i].timestamp_delta);
+                    }
+                }
+            }
+        }
+        if (frames <= 0) {
+            // the read is used up
+            self->pending_chan = -1;
+        }
+        if (frames < 0) {
+            mp_raise_OSError(-frames);
+        }
+
+        if (got == before && got < n && fresh) {
+            if ((mp_int_t)(mp_hal_ticks_ms() - t0) >= args[ARG_timeout_ms].u_int) {
+                break;
+            }
+            // the sensor has nothing buffered, let it sample
+            MP_THREAD_GIL_EXIT();
+            k_msleep(1);
+            MP_THREAD_GIL_ENTER();
+            mp_handle_pending(MP_HANDLE_PENDING_CALLBACKS_AND_EXCEPTIONS);
+        }
+    }
+    return MP_OBJ_NEW_SMALL_INT(got);
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(sensor_read_batch_obj, 4, sensor_read_batch);
+#endif // CONFIG_SENSOR_ASYNC_API
+
 static const mp_rom_map_elem_t sensor_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_measure), MP_ROM_PTR(&sensor_measure_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_float), MP_ROM_PTR(&sensor_get_float_obj) },
@@ -170,6 +375,9 @@ static const mp_rom_map_elem_t sensor_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_attr_get_millis), MP_ROM_PTR(&sensor_attr_get_millis_obj) },
     { MP_ROM_QSTR(MP_QSTR_attr_get_int), MP_ROM_PTR(&sensor_attr_get_int_obj) },
     { MP_ROM_QSTR(MP_QSTR_attr_set), MP_ROM_PTR(&sensor_attr_set_obj) },
+    #ifdef CONFIG_SENSOR_ASYNC_API
+    { MP_ROM_QSTR(MP_QSTR_read_batch), MP_ROM_PTR(&sensor_read_batch_obj) },
+    #endif
 };
 
 static MP_DEFINE_CONST_DICT(sensor_locals_dict, sensor_locals_dict_table);
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// zephyr.Camera: frames of the camera service without a copy. acquire()
+// borrows the next captured frame from the capture loop and returns a
+// read-only memoryview onto the video buffer itself; release() gives the
+// buffer back to the camera. The memoryview must not be used after
+// release(). Capture keeps running on the other buffers meanwhile.
+
+#include "modzephyr.h"
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+
+#ifdef CONFIG_VIDEO_CAMERA
+
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <app/camera.h>
+
+typedef struct _zephyr_camera_obj_t {
+    mp_obj_base_t base;
+    struct camera_frame frame;
+} zephyr_camera_obj_t;
+
+static mp_obj_t zephyr_camera_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 0, 0, false);
+    // a frame left acquired by a collected object goes back to the camera
+    zephyr_camera_obj_t *self = mp_obj_malloc_with_finaliser(zephyr_camera_obj_t, type);
+    self->frame.vbuf = NULL;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+static void zephyr_camera_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    zephyr_camera_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->frame.vbuf == NULL) {
+        mp_printf(print, "<Camera>");
+    } else {
+        mp_printf(print, "<Camera %.4s %ux%u>", (const char *)&self->frame.pixelformat,
+            self->frame.width, self->frame.height);
+    }
+}
+
+// acquire(timeout_ms=1000): memoryview of the next frame, or None on timeout
+static mp_obj_t zephyr_camera_acquire(size_t n_args, const mp_obj_t *args) {
+    zephyr_camera_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t timeout_ms = n_args > 1 ? mp_obj_get_int(args[1]) : 1000;
+    mp_uint_t t0 = mp_hal_ticks_ms();
+    int err;
+
+    if (self->frame.vbuf != NULL) {
+        mp_raise_OSError(MP_EBUSY);
+    }
+
+    // wait in slices so KeyboardInterrupt and other threads still run
+    do {
+        mp_uint_t dt = mp_hal_ticks_ms() - t0;
+        mp_int_t slice = timeout_ms < 0 ? 50 : MIN(50, timeout_ms - (mp_int_t)dt);
+        MP_THREAD_GIL_EXIT();
+        err = camera_acquire(&self->frame, K_MSEC(MAX(slice, 0)));
+        MP_THREAD_GIL_ENTER();
+        if (err == 0) {
+            break;
+        }
+        if (err != -EAGAIN) {
+            mp_raise_OSError(-err);
+        }
+        mp_handle_pending(MP_HANDLE_PENDING_CALLBACKS_AND_EXCEPTIONS);
+    } while (timeout_ms < 0 || (mp_int_t)(mp_hal_ticks_ms() - t0) < timeout_ms);
+
+    if (err != 0) {
+        return mp_const_none;
+    }
+    return mp_obj_new_memoryview('B', self->frame.size, (void *)self->frame.buffer);
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(zephyr_camera_acquire_obj, 1, 2, zephyr_camera_acquire);
+
+static mp_obj_t zephyr_camera_release(mp_obj_t self_in) {
+    zephyr_camera_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    camera_release(&self->frame);
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(zephyr_camera_release_obj, zephyr_camera_release);
+
+static mp_obj_t zephyr_camera_exit(size_t n_args, const mp_obj_t *args) {
+    return zephyr_camera_release(args[0]);
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(zephyr_camera_exit_obj, 4, 4, zephyr_camera_exit);
+
+// width, height, pitch, format and timestamp of the acquired frame
+static void zephyr_camera_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    zephyr_camera_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    const struct camera_frame *frame = &self->frame;
+
+    if (dest[0] != MP_OBJ_NULL) {
+        return;
+    }
+    if (attr == MP_QSTR_width || attr == MP_QSTR_height || attr == MP_QSTR_pitch
+        || attr == MP_QSTR_format || attr == MP_QSTR_timestamp) {
+        if (frame->vbuf == NULL) {
+            dest[0] = mp_const_none;
+        } else if (attr == MP_QSTR_width) {
+            dest[0] = MP_OBJ_NEW_SMALL_INT(frame->width);
+        } else if (attr == MP_QSTR_height) {
+            dest[0] = MP_OBJ_NEW_SMALL_INT(frame->height);
+        } else if (attr == MP_QSTR_pitch) {
+            dest[0] = MP_OBJ_NEW_SMALL_INT(frame->pitch);
+        } else if (attr == MP_QSTR_format) {
+            dest[0] = mp_obj_new_str((const char *)&frame->pixelformat, 4);
+        } else {
+            dest[0] = mp_obj_new_int_from_uint(frame->timestamp);
+        }
+        return;
+    }
+    // not a frame attribute, continue with the locals dict
+    dest[1] = MP_OBJ_SENTINEL;
+}
+
+// read-only, valid while a frame is acquired
+static mp_int_t zephyr_camera_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
+    zephyr_camera_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    if (self->frame.vbuf == NULL || (flags & MP_BUFFER_WRITE)) {
+        return 1;
+    }
+    bufinfo->buf = (void *)self->frame.buffer;
+    bufinfo->len = self->frame.size;
+    bufinfo->typecode = 'B';
+    return 0;
+}
+
+static const mp_rom_map_elem_t zephyr_camera_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_acquire), MP_ROM_PTR(&zephyr_camera_acquire_obj) },
+    { MP_ROM_QSTR(MP_QSTR_release), MP_ROM_PTR(&zephyr_camera_release_obj) },
+    { MP_ROM_QSTR(MP_QSTR___del__), MP_ROM_PTR(&zephyr_camera_release_obj) },
+    { MP_ROM_QSTR(MP_QSTR___enter__), MP_ROM_PTR(&mp_identity_obj) },
+    { MP_ROM_QSTR(MP_QSTR___exit__), MP_ROM_PTR(&zephyr_camera_exit_obj) },
+};
+static MP_DEFINE_CONST_DICT(zephyr_camera_locals_dict, zephyr_camera_locals_dict_table);
+
+MP_DEFINE_CONST_OBJ_TYPE(
+    zephyr_camera_type,
+    MP_QSTR_Camera,
+    MP_TYPE_FLAG_NONE,
+    make_new, zephyr_camera_make_new,
+    print, zephyr_camera_print,
+    attr, zephyr_camera_attr,
+    buffer, zephyr_camera_get_buffer,
+    locals_dict, &zephyr_camera_locals_dict
+    );
+
+#endif // CONFIG_VIDEO_CAMERA
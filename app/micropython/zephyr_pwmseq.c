@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// zephyr.PWMSequence(("pwm_x", channel), invert=False): plays a sequence
+// of (period_ns, pulse_ns, duration_us) steps on a PWM channel timed by a
+// kernel timer. play() returns at once and the sequence runs from the
+// system work queue, without Python, until it ends.
+
+#include "modzephyr.h"
+#include "py/runtime.h"
+#include "zephyr_device.h"
+
+#ifdef CONFIG_HU_APP_PWMSEQ
+
+#include <app/pwmseq.h>
+
+typedef struct _zephyr_pwmseq_obj_t {
+    mp_obj_base_t base;
+    const struct device *dev;
+    uint32_t channel;
+    pwm_flags_t flags;
+} zephyr_pwmseq_obj_t;
+
+static mp_obj_t zephyr_pwmseq_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_id, ARG_invert };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_id, MP_ARG_REQUIRED | MP_ARG_OBJ },
+        { MP_QSTR_invert, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_obj_t *items;
+    if (!mp_obj_is_type(args[ARG_id].u_obj, &mp_type_tuple)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("id must be tuple of (\"pwm_x\", channel#)"));
+    }
+    mp_obj_get_array_fixed_n(args[ARG_id].u_obj, 2, &items);
+
+    zephyr_pwmseq_obj_t *self = mp_obj_malloc(zephyr_pwmseq_obj_t, type);
+    self->dev = zephyr_device_find(items[0]);
+    self->channel = mp_obj_get_int(items[1]);
+    self->flags = args[ARG_invert].u_bool ? PWM_POLARITY_INVERTED : 0;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+static void zephyr_pwmseq_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    zephyr_pwmseq_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_printf(print, "<PWMSequence %s channel=%u%s>", zephyr_device_get_name(self->dev),
+        self->channel, pwmseq_busy(self->dev, self->channel) ? " playing" : "");
+}
+
+// play(seq, repeat=1): seq is a sequence of (period_ns, pulse_ns, duration_us),
+// repeat=0 loops until stop()
+static mp_obj_t zephyr_pwmseq_play(size_t n_args, const mp_obj_t *args) {
+    zephyr_pwmseq_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t repeat = n_args > 2 ? mp_obj_get_int(args[2]) : 1;
+    size_t count;
+    mp_obj_t *items;
+
+    mp_obj_get_array(args[1], &count, &items);
+    if (count == 0 || count > CONFIG_HU_APP_PWMSEQ_MAX_STEPS) {
+        mp_raise_ValueError(MP_ERROR_TEXT("sequence length"));
+    }
+
+    // only needed until the player has converted the steps
+    struct pwmseq_step *steps = m_new(struct pwmseq_step, count);
+    for (size_t i = 0; i < count; i++) {
+        mp_obj_t *step;
+        mp_obj_get_array_fixed_n(items[i], 3, &step);
+        steps[i].period = mp_obj_get_int(step[0]);
+        steps[i].pulse = mp_obj_get_int(step[1]);
+        steps[i].duration_us = mp_obj_get_int(step[2]);
+    }
+
+    int err = pwmseq_play(self->dev, self->channel, self->flags, steps, count, repeat);
+    m_del(struct pwmseq_step, steps, count);
+    if (err != 0) {
+        mp_raise_OSError(-err);
+    }
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(zephyr_pwmseq_play_obj, 2, 3, zephyr_pwmseq_play);
+
+// stop(): the output keeps the current step
+static mp_obj_t zephyr_pwmseq_stop(mp_obj_t self_in) {
+    zephyr_pwmseq_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    pwmseq_stop(self->dev, self->channel);
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(zephyr_pwmseq_stop_obj, zephyr_pwmseq_stop);
+
+static mp_obj_t zephyr_pwmseq_busy(mp_obj_t self_in) {
+    zephyr_pwmseq_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_bool(pwmseq_busy(self->dev, self->channel));
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(zephyr_pwmseq_busy_obj, zephyr_pwmseq_busy);
+
+static const mp_rom_map_elem_t zephyr_pwmseq_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_play), MP_ROM_PTR(&zephyr_pwmseq_play_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&zephyr_pwmseq_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_busy), MP_ROM_PTR(&zephyr_pwmseq_busy_obj) },
+};
+static MP_DEFINE_CONST_DICT(zephyr_pwmseq_locals_dict, zephyr_pwmseq_locals_dict_table);
+
+MP_DEFINE_CONST_OBJ_TYPE(
+    zephyr_pwmseq_type,
+    MP_QSTR_PWMSequence,
+    MP_TYPE_FLAG_NONE,
+    make_new, zephyr_pwmseq_make_new,
+    print, zephyr_pwmseq_print,
+    locals_dict, &zephyr_pwmseq_locals_dict
+    );
+
+#endif // CONFIG_HU_APP_PWMSEQ
@@ -10,9 +10,21 @@
 #include <zephyr/drivers/display.h>
 #include <zephyr/drivers/video.h>
 #include <zephyr/drivers/video-controls.h>
+#include <zephyr/multi_heap/shared_multi_heap.h>
 #include <zephyr/logging/log.h>
 #include <lvgl.h>
 
+#include <app/camera.h>
+#include <app/vconvert.h>
+#include <app/vmotion.h>
+#include <hu/hupacket.h>
+
+#include "main.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
 LOG_MODULE_REGISTER(camera, CONFIG_LOG_DEFAULT_LEVEL);
 
 #if !DT_HAS_CHOSEN(zephyr_camera)
@@ -23,44 +35,175 @@ LOG_MODULE_REGISTER(camera, CONFIG_LOG_DEFAULT_LEVEL);
 #error No display chosen in devicetree. Missing "--shield" flag?
 #endif
 
-static int _main(void)
-{
-	struct video_buffer *buffers[2];
-	struct video_buffer *vbuf = &(struct video_buffer){};
-	const struct device *display_dev;
+#if CONFIG_DCACHE_LINE_SIZE
+#define BUFFER_ALIGN	MAX(CONFIG_VIDEO_BUFFER_POOL_ALIGN, CONFIG_DCACHE_LINE_SIZE)
+#else
+#define BUFFER_ALIGN	CONFIG_VIDEO_BUFFER_POOL_ALIGN
+#endif
+
+#if CONFIG_VIDEO_CONVERT
+/* the capture buffers and the two display frames share the pool */
+BUILD_ASSERT(CONFIG_VIDEO_BUFFER_POOL_NUM_MAX >= CONFIG_VIDEO_BUFFERS + 2,
+	     "VIDEO_CONVERT needs VIDEO_BUFFER_POOL_NUM_MAX >= VIDEO_BUFFERS + 2");
+#endif
+
+#define DEQUEUE_TIMEOUT	K_MSEC(100)	/* how often the capture loop checks for stop */
+#define START_TIMEOUT	K_SECONDS(2)
+#define STOP_TIMEOUT	K_SECONDS(2)
+
+enum {
+	CAMERA_ACTIVE,		/* a capture session runs */
+	CAMERA_STOP,		/* the session was asked to end */
+	CAMERA_WANT,		/* camera_acquire() waits for a frame */
+};
+
+struct camera {
 	const struct device *video_dev;
+	const struct device *display_dev;
+	struct camera_config config;
+
 	struct video_format fmt;
-	struct video_caps caps;
-	enum video_buf_type type = VIDEO_BUF_TYPE_OUTPUT;
-	struct video_selection sel = {
-		.type = VIDEO_BUF_TYPE_OUTPUT,
+	struct video_format disp_fmt;
+	struct video_buffer *buffers[CONFIG_VIDEO_BUFFERS];
+#if CONFIG_VIDEO_CONVERT
+	struct video_buffer *frames[2];
+#endif
+#if !CONFIG_VIDEO_DISPLAY_WRITE
+	lv_obj_t *screen;
+#endif
+
+	atomic_t flags;
+	struct k_mutex lock;
+	struct k_sem start;
+	struct k_sem started;
+	int result;		/* of the last session start, for camera_start() */
+	struct k_sem stopped;
+	struct k_thread thread;
+
+	/* frame lent to camera_acquire() */
+	struct k_mutex frame_lock;
+	struct k_sem frame_ready;
+	struct camera_frame frame;
+	struct video_buffer *held;
+	struct video_buffer *orphan;	/* held when its session ended */
+};
+
+static struct camera camera;
+static K_KERNEL_STACK_DEFINE(camera_stack, CONFIG_VIDEO_CAMERA_STACK_SIZE);
+
+#if CONFIG_VIDEO_MEMORY_REGION
+/* video buffers come from this region through the shared multi heap */
+static struct shared_multi_heap_region video_region = {
+	.addr = DT_REG_ADDR(DT_CHOSEN(hu_video_memory)),
+	.size = DT_REG_SIZE(DT_CHOSEN(hu_video_memory)),
+	.attr = CONFIG_VIDEO_BUFFER_SMH_ATTRIBUTE,
+};
+
+#if !CONFIG_VIDEO_CONVERT
+/* capture buffers are display frames, the region has to hold all of them */
+BUILD_ASSERT(DT_REG_SIZE(DT_CHOSEN(hu_video_memory)) >=
+	     CONFIG_VIDEO_BUFFERS * CONFIG_VIDEO_WIDTH * CONFIG_VIDEO_HEIGHT * 2,
+	     "hu,video-memory is smaller than VIDEO_BUFFERS RGB565 frames");
+#endif
+#endif
+
+#if CONFIG_VIDEO_DISPLAY_WRITE
+static int _show(struct camera *c, struct video_buffer *vbuf)
+{
+	const struct video_format *fmt = &c->disp_fmt;
+	struct display_buffer_descriptor desc = {
+		.buf_size = vbuf->bytesused,
+		.width = fmt->width,
+		.height = fmt->height,
+		.pitch = fmt->pitch / video_bits_per_pixel(fmt->pixelformat) * BITS_PER_BYTE,
 	};
-	int i = 0;
-	int err;
 
-	display_dev = DEVICE_DT_GET(DT_CHOSEN(zephyr_display));
-	if (!device_is_ready(display_dev)) {
-		LOG_ERR("Device not ready, aborting test");
-		return 0;
+	/* returns once the controller has latched the new frame */
+	return display_write(c->display_dev, 0, 0, &desc, vbuf->buffer);
+}
+#else
+static lv_img_dsc_t video_img = {
+	.header.cf = LV_COLOR_FORMAT_NATIVE,
+};
+
+static int _show(struct camera *c, struct video_buffer *vbuf)
+{
+	/* point the image at the frame just captured, not at a fixed buffer */
+	video_img.header.w = c->disp_fmt.width;
+	video_img.header.h = c->disp_fmt.height;
+	video_img.data_size = c->disp_fmt.pitch * c->disp_fmt.height;
+	video_img.data = (const uint8_t *)vbuf->buffer;
+	lv_image_cache_drop(&video_img);
+	lv_img_set_src(c->screen, &video_img);
+	lv_obj_invalidate(c->screen);
+
+	lv_task_handler();
+	return 0;
+}
+#endif
+
+int camera_enqueue(const struct device *video_dev, struct video_buffer *vbuf)
+{
+	int err = video_enqueue(video_dev, vbuf);
+
+	if (err == 0) {
+		vstats_queued(1);
+	}
+	return err;
+}
+
+/* hands the buffer to a waiting camera_acquire() instead of the camera */
+static int _lend(struct camera *c, struct video_buffer *vbuf)
+{
+	int err = -EAGAIN;
+
+	if (!atomic_test_bit(&c->flags, CAMERA_WANT)) {
+		return err;
+	}
+
+	k_mutex_lock(&c->frame_lock, K_FOREVER);
+	if (c->held == NULL && atomic_test_and_clear_bit(&c->flags, CAMERA_WANT)) {
+		c->held = vbuf;
+		c->frame = (struct camera_frame){
+			.vbuf = vbuf,
+			.buffer = vbuf->buffer,
+			.size = vbuf->bytesused,
+			.timestamp = vbuf->timestamp,
+			.pixelformat = c->fmt.pixelformat,
+			.width = c->fmt.width,
+			.height = c->fmt.height,
+			.pitch = c->fmt.pitch,
+		};
+		k_sem_give(&c->frame_ready);
+		err = 0;
 	}
+	k_mutex_unlock(&c->frame_lock);
+	return err;
+}
 
-	video_dev = DEVICE_DT_GET(DT_CHOSEN(zephyr_camera));
-	if (!device_is_ready(video_dev)) {
-		LOG_ERR("%s device is not ready", video_dev->name);
+static int _release(struct camera *c, struct video_buffer *vbuf)
+{
+	if (_lend(c, vbuf) == 0) {
+		return 0;
+	}
+	/* the stream thread gives the buffer back to the camera itself */
+	if (IS_ENABLED(CONFIG_VIDEO_STREAM) && vstream_submit(vbuf, &c->fmt) == 0) {
 		return 0;
 	}
+	return camera_enqueue(c->video_dev, vbuf);
+}
 
-	LOG_INF("- Device name: %s", video_dev->name);
+static void _log_caps(const struct device *video_dev)
+{
+	struct video_caps caps = {.type = VIDEO_BUF_TYPE_OUTPUT};
 
-	/* Get capabilities */
-	caps.type = type;
 	if (video_get_caps(video_dev, &caps)) {
 		LOG_ERR("Unable to retrieve video capabilities");
-		return 0;
+		return;
 	}
 
 	LOG_INF("- Capabilities:");
-	while (caps.format_caps[i].pixelformat) {
+	for (int i = 0; caps.format_caps[i].pixelformat; i++) {
 		const struct video_format_cap *fcap = &caps.format_caps[i];
 		/* four %c to string */
 		LOG_INF("  %c%c%c%c width [%u; %u; %u] height [%u; %u; %u]",
@@ -68,14 +211,23 @@ static int _main(void)
 			(char)(fcap->pixelformat >> 16), (char)(fcap->pixelformat >> 24),
 			fcap->width_min, fcap->width_max, fcap->width_step, fcap->height_min,
 			fcap->height_max, fcap->height_step);
-		i++;
 	}
+}
+
+static int _set_format(struct camera *c)
+{
+	const struct device *video_dev = c->video_dev;
+	struct video_format *fmt = &c->fmt;
+	struct video_selection sel = {
+		.type = VIDEO_BUF_TYPE_OUTPUT,
+	};
+	int err;
 
 	/* Get default/native format */
-	fmt.type = type;
-	if (video_get_format(video_dev, &fmt)) {
+	fmt->type = VIDEO_BUF_TYPE_OUTPUT;
+	if (video_get_format(video_dev, fmt)) {
 		LOG_ERR("Unable to retrieve video format");
-		return 0;
+		return -EIO;
 	}
 
 	/* Set the crop setting if necessary */
@@ -87,16 +239,20 @@ static int _main(void)
 	sel.rect.height = CONFIG_VIDEO_SOURCE_CROP_HEIGHT;
 	if (video_set_selection(video_dev, &sel)) {
 		LOG_ERR("Unable to set selection crop");
-		return 0;
+		return -EIO;
 	}
 	LOG_INF("Selection crop set to (%u,%u)/%ux%u",
 		sel.rect.left, sel.rect.top, sel.rect.width, sel.rect.height);
 #endif
 
-	/* Set format */
-	fmt.width = CONFIG_VIDEO_WIDTH;
-	fmt.height = CONFIG_VIDEO_HEIGHT;
-	fmt.pixelformat = VIDEO_PIX_FMT_RGB565;
+	/* Set format, with conversion the sensor keeps its own unless configured */
+	if (c->config.width && c->config.height) {
+		fmt->width = c->config.width;
+		fmt->height = c->config.height;
+	}
+	if (c->config.pixelformat) {
+		fmt->pixelformat = c->config.pixelformat;
+	}
 
 	/*
 	 * Check (if possible) if targeted size is same as crop
@@ -106,98 +262,515 @@ static int _main(void)
 	err = video_get_selection(video_dev, &sel);
 	if (err < 0 && err != -ENOSYS) {
 		LOG_ERR("Unable to get selection crop");
-		return 0;
+		return err;
 	}
 
-	if (err == 0 && (sel.rect.width != fmt.width || sel.rect.height != fmt.height)) {
+	if (err == 0 && (sel.rect.width != fmt->width || sel.rect.height != fmt->height)) {
 		sel.target = VIDEO_SEL_TGT_COMPOSE;
 		sel.rect.left = 0;
 		sel.rect.top = 0;
-		sel.rect.width = fmt.width;
-		sel.rect.height = fmt.height;
+		sel.rect.width = fmt->width;
+		sel.rect.height = fmt->height;
 		err = video_set_selection(video_dev, &sel);
 		if (err < 0 && err != -ENOSYS) {
 			LOG_ERR("Unable to set selection compose");
-			return 0;
+			return err;
 		}
 	}
 
-	if (video_set_format(video_dev, &fmt)) {
+	if (video_set_format(video_dev, fmt)) {
 		LOG_ERR("Unable to set up video format");
-		return 0;
+		return -EINVAL;
 	}
 
-	LOG_INF("- Format: %c%c%c%c %ux%u %u", (char)fmt.pixelformat, (char)(fmt.pixelformat >> 8),
-		(char)(fmt.pixelformat >> 16), (char)(fmt.pixelformat >> 24), fmt.width, fmt.height,
-		fmt.pitch);
+	LOG_INF("- Format: %c%c%c%c %ux%u %u", (char)fmt->pixelformat,
+		(char)(fmt->pixelformat >> 8), (char)(fmt->pixelformat >> 16),
+		(char)(fmt->pixelformat >> 24), fmt->width, fmt->height, fmt->pitch);
+
+#if CONFIG_VIDEO_CONVERT
+	c->disp_fmt = (struct video_format){
+		.pixelformat = VIDEO_PIX_FMT_RGB565,
+		.width = CONFIG_VIDEO_WIDTH,
+		.height = CONFIG_VIDEO_HEIGHT,
+		.pitch = CONFIG_VIDEO_WIDTH * 2,
+	};
+#else
+	c->disp_fmt = *fmt;
+#endif
+	return 0;
+}
+
+static void _free_buffers(struct camera *c)
+{
+	/* a frame still lent out is freed by camera_release() */
+	k_mutex_lock(&c->frame_lock, K_FOREVER);
+	for (int i = 0; i < ARRAY_SIZE(c->buffers); i++) {
+		if (c->buffers[i] != NULL && c->buffers[i] != c->orphan) {
+			video_buffer_release(c->buffers[i]);
+		}
+		c->buffers[i] = NULL;
+	}
+	k_mutex_unlock(&c->frame_lock);
+#if CONFIG_VIDEO_CONVERT
+	for (int i = 0; i < ARRAY_SIZE(c->frames); i++) {
+		if (c->frames[i] != NULL) {
+			video_buffer_release(c->frames[i]);
+			c->frames[i] = NULL;
+		}
+	}
+#endif
+}
 
+static int _alloc_buffers(struct camera *c)
+{
 	/* Alloc video buffers and enqueue for capture */
-	for (i = 0; i < ARRAY_SIZE(buffers); i++) {
-		buffers[i] = video_buffer_aligned_alloc(fmt.size, CONFIG_VIDEO_BUFFER_POOL_ALIGN,
-							K_NO_WAIT);
-		if (buffers[i] == NULL) {
+	for (int i = 0; i < ARRAY_SIZE(c->buffers); i++) {
+		c->buffers[i] = video_buffer_aligned_alloc(c->fmt.size, BUFFER_ALIGN, K_NO_WAIT);
+		if (c->buffers[i] == NULL) {
 			LOG_ERR("Unable to alloc video buffer");
-			return 0;
+			return -ENOMEM;
 		}
-		buffers[i]->type = type;
-		video_enqueue(video_dev, buffers[i]);
+		c->buffers[i]->type = VIDEO_BUF_TYPE_OUTPUT;
+		camera_enqueue(c->video_dev, c->buffers[i]);
 	}
 
-	/* Set controls */
-	struct video_control ctrl = {.id = VIDEO_CID_HFLIP, .val = 1};
+#if CONFIG_VIDEO_CONVERT
+	/*
+	 * Capture stays in the sensor format and size, two RGB565 frames at the
+	 * display size take the converted output, one shown while the other is
+	 * written.
+	 */
+	for (int i = 0; i < ARRAY_SIZE(c->frames); i++) {
+		size_t size = c->disp_fmt.pitch * c->disp_fmt.height;
 
-	if (IS_ENABLED(CONFIG_VIDEO_HFLIP)) {
-		video_set_ctrl(video_dev, &ctrl);
+		c->frames[i] = video_buffer_aligned_alloc(size, BUFFER_ALIGN, K_NO_WAIT);
+		if (c->frames[i] == NULL) {
+			LOG_ERR("Unable to alloc display frame of %zu bytes after %d of %u",
+				size, CONFIG_VIDEO_BUFFERS, c->fmt.size);
+			return -ENOMEM;
+		}
+		c->frames[i]->bytesused = size;
 	}
+#endif
+	return 0;
+}
 
-	if (IS_ENABLED(CONFIG_VIDEO_VFLIP)) {
-		ctrl.id = VIDEO_CID_VFLIP;
-		video_set_ctrl(video_dev, &ctrl);
-	}
+static void _capture(struct camera *c)
+{
+	const struct device *video_dev = c->video_dev;
+	struct video_buffer *vbuf = &(struct video_buffer){};
+	struct video_buffer *next = &(struct video_buffer){};
+	uint32_t timestamp, dequeued;
+#if CONFIG_VIDEO_CONVERT
+	int cur = 0;
+#else
+	struct video_buffer *shown = NULL;
+#endif
+	int err;
 
-	/* Start video capture */
-	if (video_stream_start(video_dev, type)) {
-		LOG_ERR("Unable to start capture (interface)");
-		return 0;
+	/*
+	 * Grab video frames. The dequeued buffer itself is displayed and stays
+	 * out of the capture queue while it is on screen; the previously shown
+	 * buffer goes back to the camera only once the display has moved on.
+	 */
+	vbuf->type = VIDEO_BUF_TYPE_OUTPUT;
+	next->type = VIDEO_BUF_TYPE_OUTPUT;
+	while (!atomic_test_bit(&c->flags, CAMERA_STOP)) {
+		err = video_dequeue(video_dev, &vbuf, DEQUEUE_TIMEOUT);
+		if (err == -EAGAIN) {
+			continue;
+		}
+		if (err) {
+			LOG_ERR("Unable to dequeue video buf");
+			return;
+		}
+		dequeued = k_cycle_get_32();
+		vstats_queued(-1);
+
+		/* display fell behind, skip to the newest frame */
+		while (video_dequeue(video_dev, &next, K_NO_WAIT) == 0) {
+			vstats_queued(-1);
+			vstats_skipped();
+			camera_enqueue(video_dev, vbuf);
+			vbuf = next;
+		}
+		timestamp = vbuf->timestamp;
+
+#if CONFIG_VIDEO_MOTION
+		vmotion_process(&c->fmt, vbuf->buffer, timestamp);
+#endif
+
+#if CONFIG_VIDEO_CONVERT
+		err = vconvert(&c->fmt, vbuf->buffer, &c->disp_fmt, c->frames[cur]->buffer,
+			       CONFIG_VIDEO_CONVERT_ROTATION);
+		if (err) {
+			LOG_ERR("Unable to convert video buf (error %d)", err);
+			vstats_error();
+		}
+
+		/* converted, the capture buffer can go back right away */
+		err = _release(c, vbuf);
+		if (err) {
+			LOG_ERR("Unable to requeue video buf");
+			return;
+		}
+		vbuf = c->frames[cur];
+		cur ^= 1;
+#endif
+
+		err = _show(c, vbuf);
+		if (err) {
+			LOG_ERR("Unable to display video buf (error %d)", err);
+			vstats_error();
+		} else {
+			vstats_shown(timestamp, dequeued);
+		}
+
+#if !CONFIG_VIDEO_CONVERT
+		if (shown != NULL) {
+			err = _release(c, shown);
+			if (err) {
+				LOG_ERR("Unable to requeue video buf");
+				return;
+			}
+		}
+		shown = vbuf;
+#endif
 	}
+}
 
-	err = display_blanking_off(display_dev);
-	if (err < 0 && err != -ENOSYS) {
-		LOG_ERR("Failed to turn blanking off (error %d)", err);
-		return 0;
+/* one capture session, everything it allocates is released before it returns */
+static void _session(struct camera *c)
+{
+	struct video_buffer *vbuf = &(struct video_buffer){.type = VIDEO_BUF_TYPE_OUTPUT};
+	bool started = false;
+	int err;
+
+	err = _set_format(c);
+	if (err == 0) {
+		err = _alloc_buffers(c);
 	}
 
-	const lv_img_dsc_t video_img = {
-		.header.w = CONFIG_VIDEO_WIDTH,
-		.header.h = CONFIG_VIDEO_HEIGHT,
-		.data_size = CONFIG_VIDEO_WIDTH * CONFIG_VIDEO_HEIGHT * sizeof(lv_color_t),
-		.header.cf = LV_COLOR_FORMAT_NATIVE,
-		.data = (const uint8_t *)buffers[0]->buffer,
-	};
+	if (err == 0) {
+		/* Set controls */
+		struct video_control ctrl = {.id = VIDEO_CID_HFLIP, .val = 1};
 
-	lv_obj_t *screen = lv_img_create(lv_scr_act());
+		if (IS_ENABLED(CONFIG_VIDEO_HFLIP)) {
+			video_set_ctrl(c->video_dev, &ctrl);
+		}
 
-	LOG_INF("- Capture started");
+		if (IS_ENABLED(CONFIG_VIDEO_VFLIP)) {
+			ctrl.id = VIDEO_CID_VFLIP;
+			video_set_ctrl(c->video_dev, &ctrl);
+		}
 
-	/* Grab video frames */
-	vbuf->type = type;
-	while (1) {
-		err = video_dequeue(video_dev, &vbuf, K_FOREVER);
+		/* Start video capture */
+		err = video_stream_start(c->video_dev, VIDEO_BUF_TYPE_OUTPUT);
 		if (err) {
-			LOG_ERR("Unable to dequeue video buf");
-			return 0;
+			LOG_ERR("Unable to start capture (interface)");
+		}
+		started = err == 0;
+	}
+
+	if (err == 0) {
+		err = display_blanking_off(c->display_dev);
+		if (err < 0 && err != -ENOSYS) {
+			LOG_ERR("Failed to turn blanking off (error %d)", err);
+		} else {
+			err = 0;
 		}
+	}
 
-		lv_img_set_src(screen, &video_img);
-		lv_obj_align(screen, LV_ALIGN_BOTTOM_LEFT, 0, 0);
+	c->result = err;
+	k_sem_give(&c->started);
 
+	if (err == 0) {
+#if !CONFIG_VIDEO_DISPLAY_WRITE
+		c->screen = lv_img_create(lv_scr_act());
+		lv_obj_align(c->screen, LV_ALIGN_BOTTOM_LEFT, 0, 0);
+#endif
+		LOG_INF("- Capture started, %d buffers", CONFIG_VIDEO_BUFFERS);
+		_capture(c);
+#if !CONFIG_VIDEO_DISPLAY_WRITE
+		/* LVGL must not redraw from a released buffer */
+		lv_obj_delete(c->screen);
+		c->screen = NULL;
 		lv_task_handler();
+#else
+		/* the display scans out the last written frame, stop it before the free */
+		err = display_blanking_on(c->display_dev);
+		if (err < 0 && err != -ENOSYS) {
+			LOG_ERR("Failed to turn blanking on (error %d)", err);
+		}
+#endif
+	}
+
+	if (started) {
+		video_stream_stop(c->video_dev, VIDEO_BUF_TYPE_OUTPUT);
+	}
+#if CONFIG_VIDEO_STREAM
+	vstream_sync();
+#endif
+	/* a frame released from now on is no longer enqueued */
+	k_mutex_lock(&c->frame_lock, K_FOREVER);
+	c->orphan = c->held;
+	k_mutex_unlock(&c->frame_lock);
+
+	/* take every buffer back from the driver before releasing them */
+	video_flush(c->video_dev, true);
+	while (video_dequeue(c->video_dev, &vbuf, K_NO_WAIT) == 0) {
+		vstats_queued(-1);
+	}
+	_free_buffers(c);
+	LOG_INF("- Capture stopped");
+}
+
+static void _camera_thread(void *arg1, void *arg2, void *arg3)
+{
+	struct camera *c = arg1;
+
+	while (1) {
+		k_sem_take(&c->start, K_FOREVER);
+		_session(c);
+		atomic_clear_bit(&c->flags, CAMERA_ACTIVE);
+		k_sem_give(&c->stopped);
+	}
+}
+
+int camera_start(void)
+{
+	struct camera *c = &camera;
+	int err = 0;
+
+	if (c->video_dev == NULL) {
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&c->lock, K_FOREVER);
+	if (atomic_test_and_set_bit(&c->flags, CAMERA_ACTIVE)) {
+		k_mutex_unlock(&c->lock);
+		return -EALREADY;
+	}
+
+	atomic_clear_bit(&c->flags, CAMERA_STOP);
+	k_sem_reset(&c->started);
+	k_sem_reset(&c->stopped);
+	k_sem_give(&c->start);
 
-		err = video_enqueue(video_dev, vbuf);
+	/* the session reports once capture runs or could not start */
+	err = k_sem_take(&c->started, START_TIMEOUT);
+	if (err) {
+		LOG_ERR("Capture did not start (error %d)", err);
+	} else {
+		err = c->result;
+	}
+	if (err) {
+		/* a failed session has ended, or is told to, before returning */
+		atomic_set_bit(&c->flags, CAMERA_STOP);
+		k_sem_take(&c->stopped, STOP_TIMEOUT);
+	}
+	k_mutex_unlock(&c->lock);
+	return err;
+}
+
+int camera_stop(void)
+{
+	struct camera *c = &camera;
+	int err = 0;
+
+	if (c->video_dev == NULL) {
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&c->lock, K_FOREVER);
+	if (atomic_test_bit(&c->flags, CAMERA_ACTIVE)) {
+		atomic_set_bit(&c->flags, CAMERA_STOP);
+		err = k_sem_take(&c->stopped, STOP_TIMEOUT);
 		if (err) {
-			LOG_ERR("Unable to requeue video buf");
-			return 0;
+			LOG_ERR("Capture did not stop (error %d)", err);
 		}
 	}
+	k_mutex_unlock(&c->lock);
+	return err;
 }
-//K_THREAD_DEFINE(camera, 4096, _main, NULL, NULL, NULL, 7, 0, 0);
+
+bool camera_running(void)
+{
+	return atomic_test_bit(&camera.flags, CAMERA_ACTIVE);
+}
+
+void camera_get_config(struct camera_config *config)
+{
+	*config = camera.config;
+}
+
+int camera_reconfigure(const struct camera_config *config)
+{
+	struct camera *c = &camera;
+	bool running = camera_running();
+	int err;
+
+	if (running && (err = camera_stop()) != 0) {
+		return err;
+	}
+	k_mutex_lock(&c->lock, K_FOREVER);
+	c->config = *config;
+	k_mutex_unlock(&c->lock);
+	return running ? camera_start() : 0;
+}
+
+int camera_acquire(struct camera_frame *frame, k_timeout_t timeout)
+{
+	struct camera *c = &camera;
+	int err = 0;
+
+	if (c->video_dev == NULL) {
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&c->frame_lock, K_FOREVER);
+	if (c->held != NULL || atomic_test_bit(&c->flags, CAMERA_WANT)) {
+		k_mutex_unlock(&c->frame_lock);
+		return -EBUSY;
+	}
+	k_sem_reset(&c->frame_ready);
+	atomic_set_bit(&c->flags, CAMERA_WANT);
+	k_mutex_unlock(&c->frame_lock);
+
+	k_sem_take(&c->frame_ready, timeout);
+
+	/* the frame may have been lent just after the timeout */
+	k_mutex_lock(&c->frame_lock, K_FOREVER);
+	atomic_clear_bit(&c->flags, CAMERA_WANT);
+	if (c->held != NULL) {
+		*frame = c->frame;
+	} else {
+		err = -EAGAIN;
+	}
+	k_mutex_unlock(&c->frame_lock);
+	return err;
+}
+
+void camera_release(struct camera_frame *frame)
+{
+	struct camera *c = &camera;
+
+	k_mutex_lock(&c->frame_lock, K_FOREVER);
+	if (frame->vbuf != NULL && frame->vbuf == c->held) {
+		if (c->orphan == c->held) {
+			for (int i = 0; i < ARRAY_SIZE(c->buffers); i++) {
+				if (c->buffers[i] == c->held) {
+					c->buffers[i] = NULL;
+				}
+			}
+			video_buffer_release(c->held);
+			c->orphan = NULL;
+		} else {
+			camera_enqueue(c->video_dev, c->held);
+		}
+		c->held = NULL;
+	}
+	k_mutex_unlock(&c->frame_lock);
+	frame->vbuf = NULL;
+}
+
+int camera_init(void)
+{
+	struct camera *c = &camera;
+
+	if (c->video_dev != NULL) {
+		return 0;
+	}
+
+	c->display_dev = DEVICE_DT_GET(DT_CHOSEN(zephyr_display));
+	if (!device_is_ready(c->display_dev)) {
+		LOG_ERR("%s device is not ready", c->display_dev->name);
+		return -ENODEV;
+	}
+
+	c->video_dev = DEVICE_DT_GET(DT_CHOSEN(zephyr_camera));
+	if (!device_is_ready(c->video_dev)) {
+		LOG_ERR("%s device is not ready", c->video_dev->name);
+		c->video_dev = NULL;
+		return -ENODEV;
+	}
+
+	LOG_INF("- Device name: %s", c->video_dev->name);
+	_log_caps(c->video_dev);
+
+#if CONFIG_VIDEO_MEMORY_REGION
+	shared_multi_heap_pool_init();
+	if (shared_multi_heap_add(&video_region, NULL)) {
+		LOG_ERR("Unable to add the video memory region");
+	}
+	LOG_INF("- Video memory %p, %u bytes", (void *)video_region.addr, video_region.size);
+#endif
+
+#if !CONFIG_VIDEO_CONVERT
+	c->config = (struct camera_config){
+		.pixelformat = VIDEO_PIX_FMT_RGB565,
+		.width = CONFIG_VIDEO_WIDTH,
+		.height = CONFIG_VIDEO_HEIGHT,
+	};
+#else
+	init_vconvert();
+#endif
+#if CONFIG_VIDEO_STREAM
+	init_vstream(c->video_dev);
+#endif
+
+	k_mutex_init(&c->lock);
+	k_sem_init(&c->start, 0, 1);
+	k_sem_init(&c->started, 0, 1);
+	k_sem_init(&c->stopped, 0, 1);
+	k_mutex_init(&c->frame_lock);
+	k_sem_init(&c->frame_ready, 0, 1);
+	k_thread_create(&c->thread, camera_stack, K_KERNEL_STACK_SIZEOF(camera_stack),
+			_camera_thread, c, NULL, NULL, CONFIG_VIDEO_CAMERA_PRIORITY, 0, K_NO_WAIT);
+	k_thread_name_set(&c->thread, "camera");
+
+	return IS_ENABLED(CONFIG_VIDEO_CAMERA_AUTOSTART) ? camera_start() : 0;
+}
+
+#if CONFIG_HU_PACKET
+/*
+ * camera: running, pixelformat, width, height
+ * camera start | stop
+ * camera config <width> <height> [fourcc]
+ */
+static void _camera(void *hup, int argc, const char **argv)
+{
+	struct camera_config config;
+	int err = 0;
+
+	if (argc > 1 && strcmp(argv[1], "start") == 0) {
+		err = camera_start();
+	} else if (argc > 1 && strcmp(argv[1], "stop") == 0) {
+		err = camera_stop();
+	} else if (argc > 3 && strcmp(argv[1], "config") == 0) {
+		camera_get_config(&config);
+		config.width = strtoul(argv[2], NULL, 0);
+		config.height = strtoul(argv[3], NULL, 0);
+		if (argc > 4 && strlen(argv[4]) == 4) {
+			config.pixelformat = video_fourcc(argv[4][0], argv[4][1],
+							  argv[4][2], argv[4][3]);
+		}
+		err = camera_reconfigure(&config);
+	}
+
+	if (err != 0 && err != -EALREADY) {
+		hupacket_nak_response(hup, NULL, err);
+		hupacket_send_buffer(hup, NULL);
+		return;
+	}
+
+	camera_get_config(&config);
+	hupacket_ack_response(hup, NULL);
+	hupacket_record_int(hup, NULL, camera_running());
+	hupacket_record_hex(hup, NULL, config.pixelformat);
+	hupacket_record_int(hup, NULL, config.width);
+	hupacket_record_int(hup, NULL, config.height);
+	hupacket_send_buffer(hup, NULL);
+}
+DEFINE_HUP_CMD(hup_cmd_camera, "camera", _camera);
+#endif
@@ -10,12 +10,15 @@
 #include <app/udp.h>
 #include <app/app_api.h>
 #include <hu/hupacket.h>
+#include <hu/hutrace.h>
 #include <hu/palloc.h>
 
 #include <zephyr/kernel.h>
 #include <zephyr/net/socket.h>
 #include <zephyr/posix/sys/socket.h>
 #include <zephyr/posix/unistd.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/slist.h>
 #include <zephyr/logging/log.h>
 
 #include <huerrno.h>
@@ -24,6 +27,8 @@
 #if CONFIG_HU_APP
 LOG_MODULE_REGISTER(hup_server, CONFIG_LOG_DEFAULT_LEVEL);
 
+#define RECV_RETRY_MS		100
+
 struct handle
 {
 	void* hup;
@@ -33,8 +38,16 @@ struct handle
 	k_tid_t tid;
 	struct k_thread tdata;
 	char buffer[RECV_BUFFER_SIZE];
+
+	/* every parser this server feeds, sessions included, counts here */
+	const char* name;
+	struct hup_stats stats;
+	sys_snode_t node;
 };
 
+static sys_slist_t servers = SYS_SLIST_STATIC_INIT(&servers);
+static K_MUTEX_DEFINE(servers_lock);
+
 static void _hup_server(void* arg1, void* arg2, void* arg3)
 {
 	int received;
@@ -42,16 +55,34 @@ static void _hup_server(void* arg1, void* arg2, void* arg3)
 
 	while (1)
 	{
-		received = h->api->recv(h->drv, h->buffer, sizeof(h->buffer));
+		uint8_t* data = h->buffer;
+
+		if (h->api->claim != NULL)
+			received = h->api->claim(h->drv, &data, sizeof(h->buffer));
+		else
+			received = h->api->recv(h->drv, h->buffer, sizeof(h->buffer));
 		if (received < 0)
 		{
-			LOG_ERR("UDP : Connection error %d", errno);
-			break;
+			h->stats.recv_errors ++;
+			LOG_ERR("%s: Receive error %d", h->name, received);
+			/* only a transport that is gone for good ends the server */
+			if (received == -EBADF || received == -ENOTSOCK || received == -ENODEV)
+				break;
+			k_msleep(RECV_RETRY_MS);
+			continue;
 		}
 		else if (received)
 		{
-			process_hupacket(h->hup, h->buffer, received);
+			void* hup = h->api->session != NULL ? h->api->session(h->drv) : NULL;
+			HUP_TRACE("hup_recv", received, h);
+			if (hup == NULL)
+				hup = h->hup;
+			hupacket_set_stats(hup, &h->stats);
+			process_hupacket(hup, data, received);
 		}
+
+		if (h->api->finish != NULL)
+			h->api->finish(h->drv, received);
 	}
 }
 
@@ -82,6 +113,11 @@ void* init_hup_server(const struct app_api* api, const char* name, void* stack,
 
 	if (stack != NULL)
 	{
+		h->name = name;
+		k_mutex_lock(&servers_lock, K_FOREVER);
+		sys_slist_append(&servers, &h->node);
+		k_mutex_unlock(&servers_lock);
+
 		h->tid = k_thread_create(&h->tdata, stack, stack_size,
 			_hup_server, h, NULL, NULL,
 			7, 0, K_NO_WAIT);
@@ -106,6 +142,10 @@ void deinit_hup_server(void *handle, const struct app_api* api)
 	if (handle == NULL)
 		return;
 
+	k_mutex_lock(&servers_lock, K_FOREVER);
+	sys_slist_find_and_remove(&servers, &h->node);
+	k_mutex_unlock(&servers_lock);
+
 	if (h->drv != NULL && api != NULL)
 		api->deinit(h->drv);
 
@@ -120,4 +160,69 @@ void deinit_hup_server(void *handle, const struct app_api* api)
 
 	pfree(handle);
 }
+
+/* "name,rx bytes,tx bytes,frames,crc errors,overflows,send errors,recv errors" */
+static int _format_stats(struct handle* h, char* buffer, size_t size)
+{
+	const struct hup_stats* s = &h->stats;
+	return snprintf(buffer, size, "%s,%u,%u,%u,%u,%u,%u,%u", h->name
+		, s->rx_bytes, s->tx_bytes, s->frames, s->crc_errors
+		, s->overflows, s->send_errors, s->recv_errors);
+}
+
+static void _reset_stats(void)
+{
+	struct handle* h;
+
+	k_mutex_lock(&servers_lock, K_FOREVER);
+	SYS_SLIST_FOR_EACH_CONTAINER(&servers, h, node)
+		memset(&h->stats, 0, sizeof(h->stats));
+	k_mutex_unlock(&servers_lock);
+}
+
+/* links [reset]: one _format_stats record per hupacket server */
+static void _links(void* hup, int argc, const char** argv)
+{
+	struct handle* h;
+	char record[96];
+
+	hupacket_ack_response(hup, NULL);
+	k_mutex_lock(&servers_lock, K_FOREVER);
+	SYS_SLIST_FOR_EACH_CONTAINER(&servers, h, node)
+	{
+		_format_stats(h, record, sizeof(record));
+		hupacket_record_str(hup, NULL, record);
+	}
+	k_mutex_unlock(&servers_lock);
+	hupacket_send_buffer(hup, NULL);
+
+	if (argc > 1 && strcmp(argv[1], "reset") == 0)
+		_reset_stats();
+}
+DEFINE_HUP_CMD(hup_cmd_links, "links", _links);
+
+#if CONFIG_SHELL
+static int _shell_links(const struct shell* sh, size_t argc, char** argv)
+{
+	struct handle* h;
+	char record[96];
+
+	if (argc > 1 && strcmp(argv[1], "reset") == 0)
+	{
+		_reset_stats();
+		return 0;
+	}
+
+	shell_print(sh, "name,rx bytes,tx bytes,frames,crc errors,overflows,send errors,recv errors");
+	k_mutex_lock(&servers_lock, K_FOREVER);
+	SYS_SLIST_FOR_EACH_CONTAINER(&servers, h, node)
+	{
+		_format_stats(h, record, sizeof(record));
+		shell_print(sh, "%s", record);
+	}
+	k_mutex_unlock(&servers_lock);
+	return 0;
+}
+SHELL_SUBCMD_ADD((hup), links, NULL, "Transport counters [reset]", _shell_links, 1, 1);
+#endif
 #endif
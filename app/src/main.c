@@ -33,6 +33,7 @@ LOG_MODULE_REGISTER(app, CONFIG_APP_LOG_LEVEL);
 
 #include <app/usb.h>
 #include <app/app_api.h>
+#include <app/camera.h>
 #include <hu/bootloader.h>
 
 #include <hu/hupacket.h>
@@ -46,8 +47,22 @@ LOG_MODULE_REGISTER(app, CONFIG_APP_LOG_LEVEL);
 #include <time.h>
 
 #define MY_PORT     				4241
+#if CONFIG_HU_APP_UDP_NET_CONTEXT
+#define hup_udp_api					udp_zc_server
+#else
+#define hup_udp_api					udp_server
+#endif
+#if CONFIG_HU_APP_USB_ACM
+#define hup_acm_api					usb_acm
+#else
+#define hup_acm_api					uart_interrupt
+#endif
 #define HUP_UDP_THREAD_STACK_SIZE	(1024 - 128)
+#define HUP_TCP_THREAD_STACK_SIZE	(1024 - 128)
 #define HUP_UART_THREAD_STACK_SIZE	(1024 - 512)
+#define HUP_RS485_THREAD_STACK_SIZE	(1024 - 512)
+#define HUP_RS485_BAUDRATE			115200
+#define HUP_BULK_THREAD_STACK_SIZE	(1024 - 512)
 
 struct app_data app =
 {
@@ -55,6 +70,9 @@ struct app_data app =
 
 	.hup_uart = NULL,
 	.hup_udp = NULL,
+	.hup_tcp = NULL,
+	.hup_rs485 = NULL,
+	.hup_bulk = NULL,
 };
 
 #if CONFIG_HU_APP
@@ -62,10 +80,25 @@ struct app_data app =
 static struct z_thread_stack_element app_stack_sect
 	__aligned(Z_KERNEL_STACK_OBJ_ALIGN)
 	hup_udp_stack_area[K_KERNEL_STACK_LEN(HUP_UDP_THREAD_STACK_SIZE)];
+#if CONFIG_HU_APP_TCP
+static struct z_thread_stack_element app_stack_sect
+	__aligned(Z_KERNEL_STACK_OBJ_ALIGN)
+	hup_tcp_stack_area[K_KERNEL_STACK_LEN(HUP_TCP_THREAD_STACK_SIZE)];
+#endif
 #endif
 static struct z_thread_stack_element app_stack_sect
 	__aligned(Z_KERNEL_STACK_OBJ_ALIGN)
 	hup_uart_stack_area[K_KERNEL_STACK_LEN(HUP_UART_THREAD_STACK_SIZE)];
+#if CONFIG_HU_APP_UART_RS485 && DT_HAS_ALIAS(hup_rs485)
+static struct z_thread_stack_element app_stack_sect
+	__aligned(Z_KERNEL_STACK_OBJ_ALIGN)
+	hup_rs485_stack_area[K_KERNEL_STACK_LEN(HUP_RS485_THREAD_STACK_SIZE)];
+#endif
+#if CONFIG_HU_APP_USB_BULK
+static struct z_thread_stack_element app_stack_sect
+	__aligned(Z_KERNEL_STACK_OBJ_ALIGN)
+	hup_bulk_stack_area[K_KERNEL_STACK_LEN(HUP_BULK_THREAD_STACK_SIZE)];
+#endif
 
 #if CONFIG_SOC_FAMILY_STM32
 #define MAGIC_VALUE 0xA500FF5A
@@ -145,8 +178,15 @@ static int init_app(void)
 static void deinit_app()
 {
 #if CONFIG_HU_APP
-	deinit_hup_server(app.hup_uart, &uart_interrupt);
-	deinit_hup_server(app.hup_udp, &udp_server);
+	deinit_hup_server(app.hup_uart, &hup_acm_api);
+	deinit_hup_server(app.hup_udp, &hup_udp_api);
+	deinit_hup_server(app.hup_tcp, &tcp_server);
+#if CONFIG_HU_APP_UART_RS485
+	deinit_hup_server(app.hup_rs485, &uart_rs485);
+#endif
+#if CONFIG_HU_APP_USB_BULK
+	deinit_hup_server(app.hup_bulk, &usb_bulk);
+#endif
 #endif
 #if CONFIG_HU_APP
 #if CONFIG_NET_CONNECTION_MANAGER
@@ -239,6 +279,10 @@ int main(void)
 
 	init_app();
 
+#if CONFIG_VIDEO_CAMERA
+	camera_init();
+#endif
+
 #if CONFIG_HU_APP
 	rc = bootloader_active_slot((uint8_t*)&partition_id);
 	if (rc != 0) {
@@ -251,16 +295,36 @@ int main(void)
 #if CONFIG_HU_APP
 #if CONFIG_NET_L2_ETHERNET
 	LOG_INF("hu packet server start for UDP port %d", MY_PORT);
-	app.hup_udp = init_hup_server(&udp_server, "hup_udp"
+	app.hup_udp = init_hup_server(&hup_udp_api, "hup_udp"
 		, hup_udp_stack_area, K_THREAD_STACK_SIZEOF(hup_udp_stack_area)
 		, (void*)MY_PORT, NULL, NULL);
+#if CONFIG_HU_APP_TCP
+	LOG_INF("hu packet server start for TCP port %d", MY_PORT);
+	app.hup_tcp = init_hup_server(&tcp_server, "hup_tcp"
+		, hup_tcp_stack_area, K_THREAD_STACK_SIZEOF(hup_tcp_stack_area)
+		, (void*)MY_PORT, NULL, NULL);
+#endif
 #endif
 
-	LOG_INF("hu packet server start for USB cdc acm uart: %p", &uart_interrupt);
-	app.hup_uart = init_hup_server(&uart_interrupt, "hup_acm"
+	LOG_INF("hu packet server start for USB cdc acm uart: %p", &hup_acm_api);
+	app.hup_uart = init_hup_server(&hup_acm_api, "hup_acm"
 		, hup_uart_stack_area, K_THREAD_STACK_SIZEOF(hup_uart_stack_area)
 		, (void*)DEVICE_DT_GET_ONE(zephyr_cdc_acm_uart), (void*)115200, "n81");
 
+#if CONFIG_HU_APP_UART_RS485 && DT_HAS_ALIAS(hup_rs485)
+	LOG_INF("hu packet server start for RS485: %p", &uart_rs485);
+	app.hup_rs485 = init_hup_server(&uart_rs485, "hup_rs485"
+		, hup_rs485_stack_area, K_THREAD_STACK_SIZEOF(hup_rs485_stack_area)
+		, (void*)DEVICE_DT_GET(DT_ALIAS(hup_rs485)), (void*)HUP_RS485_BAUDRATE, "n81");
+#endif
+
+#if CONFIG_HU_APP_USB_BULK
+	LOG_INF("hu packet server start for USB bulk: %p", &usb_bulk);
+	app.hup_bulk = init_hup_server(&usb_bulk, "hup_bulk"
+		, hup_bulk_stack_area, K_THREAD_STACK_SIZEOF(hup_bulk_stack_area)
+		, NULL, NULL, NULL);
+#endif
+
 #if DT_HAS_ALIAS(rtc)
 #if !defined(CONFIG_BOARD_HAS_VBAT_BATTERY)
 	set_date_time(rtc);
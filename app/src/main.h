@@ -8,6 +8,7 @@
 #define __MAIN_H__
 
 #include <app/app_api.h>
+#include <zephyr/kernel.h>
 #include <zephyr/net/net_mgmt.h>
 
 #include <stdint.h>
@@ -25,6 +26,9 @@ struct app_data {
 
 	void* hup_uart;
 	void* hup_udp;
+	void* hup_tcp;
+	void* hup_rs485;
+	void* hup_bulk;
 
 #if CONFIG_NET_CONNECTION_MANAGER
     struct net_mgmt_event_callback mgmt_cb;
@@ -44,4 +48,26 @@ void* init_hup_server(const struct app_api* api
     , void* arg1, void* arg2, void* arg3);
 void deinit_hup_server(void *handle, const struct app_api* api);
 
+struct device;
+struct video_buffer;
+struct video_format;
+
+int init_vstream(const struct device* video_dev);
+int vstream_submit(struct video_buffer* vbuf, const struct video_format* fmt);
+void vstream_sync(void);
+
+int camera_enqueue(const struct device* video_dev, struct video_buffer* vbuf);
+
+#if CONFIG_VIDEO_STATS
+void vstats_queued(int delta);
+void vstats_skipped(void);
+void vstats_error(void);
+void vstats_shown(uint32_t timestamp, uint32_t dequeued);
+#else
+static inline void vstats_queued(int delta) {}
+static inline void vstats_skipped(void) {}
+static inline void vstats_error(void) {}
+static inline void vstats_shown(uint32_t timestamp, uint32_t dequeued) {}
+#endif
+
 #endif // __MAIN_H__
@@ -19,6 +19,7 @@ LOG_MODULE_DECLARE(app, CONFIG_APP_LOG_LEVEL);
 #include <zephyr/device.h>
 #include <zephyr/drivers/pwm.h>
 #include <zephyr/drivers/led.h>
+#include <app/pwmseq.h>
 
 #include <stdint.h>
 #include <stdbool.h>
@@ -29,6 +30,24 @@ LOG_MODULE_DECLARE(app, CONFIG_APP_LOG_LEVEL);
 
 static const struct pwm_dt_spec pwm_led = PWM_DT_SPEC_GET(DT_ALIAS(pwm_led0));
 
+#if CONFIG_HU_APP_PWMSEQ
+static struct pwmseq_step sweep[CONFIG_HU_APP_PWMSEQ_MAX_STEPS];
+
+/* the same sweep as the loop below, played from a timer without this thread */
+static int play_sweep(uint32_t max_period, uint32_t min_period)
+{
+	size_t count = 0;
+
+	for (uint32_t p = max_period; p >= min_period && count < ARRAY_SIZE(sweep); p /= 2U) {
+		sweep[count++] = (struct pwmseq_step){p, p / 2U, 4U * USEC_PER_SEC};
+	}
+	for (uint32_t p = min_period * 2U; p < max_period && count < ARRAY_SIZE(sweep); p *= 2U) {
+		sweep[count++] = (struct pwmseq_step){p, p / 2U, 4U * USEC_PER_SEC};
+	}
+	return pwmseq_play(pwm_led.dev, pwm_led.channel, pwm_led.flags, sweep, count, 0);
+}
+#endif
+
 /*static*/ void start_pwmleds(void*, void*, void*)
 {
 	uint64_t cycle_per_sec;
@@ -66,6 +85,14 @@ static const struct pwm_dt_spec pwm_led = PWM_DT_SPEC_GET(DT_ALIAS(pwm_led0));
 	}
 	LOG_INF("Done calibrating; maximum/minimum periods %u/%u nsec", max_period, (pwm_led.period / MIN_SCALE));
 
+#if CONFIG_HU_APP_PWMSEQ
+	ret = play_sweep(max_period, pwm_led.period / MIN_SCALE);
+	if (ret) {
+		LOG_ERR("Error %d: failed to play the PWM sweep", ret);
+	}
+	return;
+#endif
+
 	period = max_period;
 	while (1) {
 		ret = pwm_set_dt(&pwm_led, period, period / 2U);
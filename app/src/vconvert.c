@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <app/vconvert.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/video.h>
+#include <zephyr/cache.h>
+#include <zephyr/logging/log.h>
+
+#include <errno.h>
+#include <string.h>
+
+#if CONFIG_VIDEO_CONVERT_DMA2D
+#include <soc.h>
+#ifndef DMA2D
+#error "VIDEO_CONVERT_DMA2D is enabled on a part without DMA2D"
+#endif
+#endif
+
+#if CONFIG_VIDEO_CONVERT
+LOG_MODULE_REGISTER(vconvert, CONFIG_LOG_DEFAULT_LEVEL);
+
+/*
+ * Converts a captured frame to the RGB565 display frame: pixel format,
+ * nearest neighbour scaling and rotation in 90 degree steps. Unscaled,
+ * unrotated RGB input goes through the DMA2D when it is available,
+ * everything else through the tiled software path.
+ */
+#define TILE	CONFIG_VIDEO_CONVERT_TILE
+
+struct job
+{
+	const uint8_t* src;
+	uint32_t src_pitch;
+	uint16_t* dst;
+	uint32_t dst_pitch;		// in pixels
+	/* unrotated position of output (0, 0) and its steps along x and y */
+	int ux0, uy0;
+	int dux_dx, duy_dx;
+	int dux_dy, duy_dy;
+};
+
+/* source column and row of every unrotated output column and row */
+static uint16_t xmap[CONFIG_VIDEO_CONVERT_MAX_SIZE];
+static uint16_t ymap[CONFIG_VIDEO_CONVERT_MAX_SIZE];
+
+static inline uint16_t _rgb565(int r, int g, int b)
+{
+	r = CLAMP(r, 0, 255);
+	g = CLAMP(g, 0, 255);
+	b = CLAMP(b, 0, 255);
+	return ((r & 0xf8) << 8) | ((g & 0xfc) << 3) | (b >> 3);
+}
+
+/* BT.601 limited range, 8 bit fixed point */
+static inline uint16_t _yuyv(const uint8_t* row, int x)
+{
+	const uint8_t* pair = row + (x & ~1) * 2;
+	int c = 298 * (pair[(x & 1) * 2] - 16) + 128;
+	int d = pair[1] - 128;
+	int e = pair[3] - 128;
+
+	return _rgb565((c + 409 * e) >> 8, (c - 100 * d - 208 * e) >> 8, (c + 516 * d) >> 8);
+}
+
+#define FETCH_RGB565(row, x)	(((const uint16_t*)(row))[x])
+#define FETCH_RGB24(row, x)		_rgb565((row)[(x) * 3], (row)[(x) * 3 + 1], (row)[(x) * 3 + 2])
+#define FETCH_YUYV(row, x)		_yuyv(row, x)
+
+/*
+ * One function per input format so the fetch is inlined. Output is walked
+ * in TILE x TILE blocks: with rotation the source is read across rows, the
+ * tile keeps those rows in the cache.
+ */
+#define DEFINE_CONVERT(name, FETCH) \
+static void name(const struct job* j, int w, int h) \
+{ \
+	for (int ty = 0; ty < h; ty += TILE) \
+	{ \
+		for (int tx = 0; tx < w; tx += TILE) \
+		{ \
+			int tw = MIN(TILE, w - tx), th = MIN(TILE, h - ty); \
+			\
+			for (int y = ty; y < ty + th; y ++) \
+			{ \
+				int ux = j->ux0 + tx * j->dux_dx + y * j->dux_dy; \
+				int uy = j->uy0 + tx * j->duy_dx + y * j->duy_dy; \
+				uint16_t* out = j->dst + y * j->dst_pitch + tx; \
+				\
+				for (int x = 0; x < tw; x ++, ux += j->dux_dx, uy += j->duy_dx) \
+				{ \
+					const uint8_t* row = j->src + ymap[uy] * j->src_pitch; \
+					*out ++ = FETCH(row, xmap[ux]); \
+				} \
+			} \
+		} \
+	} \
+}
+
+DEFINE_CONVERT(_convert_rgb565, FETCH_RGB565)
+DEFINE_CONVERT(_convert_rgb24, FETCH_RGB24)
+DEFINE_CONVERT(_convert_yuyv, FETCH_YUYV)
+
+#if CONFIG_VIDEO_CONVERT_DMA2D
+static DMA2D_HandleTypeDef dma2d;
+static K_MUTEX_DEFINE(dma2d_lock);
+
+static int _dma2d(const struct video_format* in, const uint8_t* src
+	, const struct video_format* out, uint8_t* dst)
+{
+	uint32_t bpp = video_bits_per_pixel(in->pixelformat) / BITS_PER_BYTE;
+	int err = 0;
+
+	k_mutex_lock(&dma2d_lock, K_FOREVER);
+	dma2d.Instance = DMA2D;
+	dma2d.Init.Mode = DMA2D_M2M_PFC;
+	dma2d.Init.ColorMode = DMA2D_OUTPUT_RGB565;
+	dma2d.Init.OutputOffset = out->pitch / 2 - out->width;
+	dma2d.LayerCfg[1].InputColorMode = in->pixelformat == VIDEO_PIX_FMT_RGB565
+		? DMA2D_INPUT_RGB565 : DMA2D_INPUT_RGB888;
+	dma2d.LayerCfg[1].InputOffset = in->pitch / bpp - out->width;
+	dma2d.LayerCfg[1].AlphaMode = DMA2D_NO_MODIF_ALPHA;
+	dma2d.LayerCfg[1].InputAlpha = 0xff;
+#ifdef DMA2D_RB_SWAP
+	/* RGB24 is R first in memory, the DMA2D reads B first */
+	dma2d.LayerCfg[1].RedBlueSwap = in->pixelformat == VIDEO_PIX_FMT_RGB24
+		? DMA2D_RB_SWAP : DMA2D_RB_REGULAR;
+#endif
+
+	sys_cache_data_flush_range((void*)src, in->pitch * out->height);
+	if (HAL_DMA2D_Init(&dma2d) != HAL_OK || HAL_DMA2D_ConfigLayer(&dma2d, 1) != HAL_OK
+		|| HAL_DMA2D_Start(&dma2d, (uint32_t)src, (uint32_t)dst, out->width, out->height) != HAL_OK
+		|| HAL_DMA2D_PollForTransfer(&dma2d, 100) != HAL_OK)
+		err = -EIO;
+	sys_cache_data_invd_range(dst, out->pitch * out->height);
+	k_mutex_unlock(&dma2d_lock);
+	return err;
+}
+
+static bool _dma2d_supported(const struct video_format* in, const struct video_format* out, int rotation)
+{
+	if (rotation != 0 || in->width != out->width || in->height != out->height)
+		return false;
+#ifdef DMA2D_RB_SWAP
+	if (in->pixelformat == VIDEO_PIX_FMT_RGB24)
+		return true;
+#endif
+	/* packed YUV is not a DMA2D input, only JPEG MCU ordered YCbCr is */
+	return in->pixelformat == VIDEO_PIX_FMT_RGB565;
+}
+#endif
+
+static void _map(uint16_t* map, int out_size, int in_size)
+{
+	uint32_t step = ((uint32_t)in_size << 16) / out_size;
+	uint32_t pos = step / 2;
+
+	for (int i = 0; i < out_size; i ++, pos += step)
+		map[i] = pos >> 16;
+}
+
+int vconvert(const struct video_format* in, const uint8_t* src
+	, const struct video_format* out, uint8_t* dst, int rotation)
+{
+	bool swap = rotation == 90 || rotation == 270;
+	/* size of the output before rotation */
+	int uw = swap ? out->height : out->width;
+	int uh = swap ? out->width : out->height;
+	struct job j =
+	{
+		.src = src,
+		.src_pitch = in->pitch,
+		.dst = (uint16_t*)dst,
+		.dst_pitch = out->pitch / 2,
+	};
+
+	if (out->pixelformat != VIDEO_PIX_FMT_RGB565)
+		return -ENOTSUP;
+	if (uw > CONFIG_VIDEO_CONVERT_MAX_SIZE || uh > CONFIG_VIDEO_CONVERT_MAX_SIZE)
+		return -EINVAL;
+
+#if CONFIG_VIDEO_CONVERT_DMA2D
+	if (_dma2d_supported(in, out, rotation))
+		return _dma2d(in, src, out, dst);
+#endif
+
+	switch (rotation)
+	{
+	case 0:
+		j.dux_dx = 1;
+		j.duy_dy = 1;
+		break;
+	case 90:	// clockwise, output row y is unrotated column y read bottom up
+		j.uy0 = uh - 1;
+		j.duy_dx = -1;
+		j.dux_dy = 1;
+		break;
+	case 180:
+		j.ux0 = uw - 1;
+		j.uy0 = uh - 1;
+		j.dux_dx = -1;
+		j.duy_dy = -1;
+		break;
+	case 270:
+		j.ux0 = uw - 1;
+		j.duy_dx = 1;
+		j.dux_dy = -1;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	_map(xmap, uw, in->width);
+	_map(ymap, uh, in->height);
+
+	switch (in->pixelformat)
+	{
+	case VIDEO_PIX_FMT_RGB565:
+		_convert_rgb565(&j, out->width, out->height);
+		break;
+	case VIDEO_PIX_FMT_RGB24:
+		_convert_rgb24(&j, out->width, out->height);
+		break;
+	case VIDEO_PIX_FMT_YUYV:
+		_convert_yuyv(&j, out->width, out->height);
+		break;
+	default:
+		return -ENOTSUP;
+	}
+	return 0;
+}
+
+int init_vconvert(void)
+{
+#if CONFIG_VIDEO_CONVERT_DMA2D
+	__HAL_RCC_DMA2D_CLK_ENABLE();
+#endif
+	return 0;
+}
+#endif
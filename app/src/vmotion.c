@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Motion detection on the dequeued capture buffer. Every frame is point
+ * sampled every VIDEO_MOTION_SCALE pixels into a small luma frame stored
+ * block major, 8 x 8 samples per block, so the sum of absolute differences
+ * of a block against the previous frame runs over 64 contiguous bytes. A
+ * block is changed when its mean difference is over the threshold, motion
+ * is reported when enough blocks changed.
+ */
+
+#include <app/vmotion.h>
+#include <hu/hupacket.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/video.h>
+#include <zephyr/logging/log.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_FEATURE_MVE)
+#include <arm_mve.h>
+#elif defined(__ARM_FEATURE_SIMD32)
+#include <arm_acle.h>
+#endif
+
+#if CONFIG_VIDEO_MOTION
+LOG_MODULE_REGISTER(vmotion, CONFIG_LOG_DEFAULT_LEVEL);
+
+#define BLOCK			8
+#define BLOCK_SIZE		(BLOCK * BLOCK)
+
+struct handle
+{
+	uint8_t luma[2][CONFIG_VIDEO_MOTION_MAX_BLOCKS * BLOCK_SIZE] __aligned(16);
+	uint8_t* cur;
+	uint8_t* prev;
+	uint16_t blocks;		// blocks of the previous frame, 0 before the first one
+
+	int threshold;
+	int min_blocks;
+	int64_t last_event;
+
+	uint32_t events;
+	struct vmotion_event event;
+};
+
+static struct handle vmotion =
+{
+	.cur = vmotion.luma[0],
+	.prev = vmotion.luma[1],
+	.threshold = CONFIG_VIDEO_MOTION_THRESHOLD,
+	.min_blocks = CONFIG_VIDEO_MOTION_MIN_BLOCKS,
+};
+
+/* events are handed to every waiter, hupacket servers and MicroPython */
+static K_MUTEX_DEFINE(event_lock);
+static K_CONDVAR_DEFINE(event_cond);
+
+#if !(defined(__ARM_FEATURE_MVE) || defined(__ARM_FEATURE_SIMD32)) || CONFIG_ZTEST
+/*
+ * SWAR: the bytes of a word are split into two words of 16 bit lanes, a - b
+ * is taken with a borrow guard at bit 8 of every lane, which also tells the
+ * sign, and negative lanes are negated without a branch. Tests build it
+ * next to the vector kernels.
+ */
+static inline uint32_t _sad4(uint32_t a, uint32_t b)
+{
+	uint32_t sad = 0;
+
+	for (int shift = 0; shift < 16; shift += 8)
+	{
+		uint32_t x = (((a >> shift) & 0x00ff00ff) | 0x01000100) - ((b >> shift) & 0x00ff00ff);
+		uint32_t neg = ((x >> 8) & 0x00010001) ^ 0x00010001;
+		uint32_t v = ((x & 0x00ff00ff) ^ (neg * 0xff)) + neg;
+
+		sad += (v & 0xffff) + (v >> 16);
+	}
+	return sad;
+}
+
+static uint32_t _sad_swar(const uint8_t* a, const uint8_t* b)
+{
+	const uint32_t* wa = (const uint32_t*)a;
+	const uint32_t* wb = (const uint32_t*)b;
+	uint32_t sad = 0;
+
+	for (int i = 0; i < BLOCK_SIZE / 4; i ++)
+		sad += _sad4(wa[i], wb[i]);
+	return sad;
+}
+#endif
+
+#if defined(__ARM_FEATURE_MVE)
+/* Helium: 16 lanes of absolute difference accumulated across the vector */
+static uint32_t _sad(const uint8_t* a, const uint8_t* b)
+{
+	uint32_t sad = 0;
+
+	for (int i = 0; i < BLOCK_SIZE; i += 16)
+		sad = vabavq_u8(sad, vld1q_u8(a + i), vld1q_u8(b + i));
+	return sad;
+}
+#elif defined(__ARM_FEATURE_SIMD32)
+/* DSP extension: four byte lanes per USADA8 */
+static uint32_t _sad(const uint8_t* a, const uint8_t* b)
+{
+	const uint32_t* wa = (const uint32_t*)a;
+	const uint32_t* wb = (const uint32_t*)b;
+	uint32_t sad = 0;
+
+	for (int i = 0; i < BLOCK_SIZE / 4; i ++)
+		sad = __usada8(wa[i], wb[i], sad);
+	return sad;
+}
+#else
+#define _sad		_sad_swar
+#endif
+
+static inline uint8_t _luma565(uint16_t p)
+{
+	uint32_t r = (p >> 8) & 0xf8, g = (p >> 3) & 0xfc, b = (p << 3) & 0xf8;
+	return (77 * r + 150 * g + 29 * b) >> 8;
+}
+
+/* point samples the frame into h->cur, returns the number of blocks */
+static int _sample(struct handle* h, const struct video_format* fmt, const uint8_t* buffer)
+{
+	int gw = fmt->width / CONFIG_VIDEO_MOTION_SCALE / BLOCK;
+	int gh = fmt->height / CONFIG_VIDEO_MOTION_SCALE / BLOCK;
+	uint8_t* out = h->cur;
+
+	if (gw * gh == 0 || gw * gh > CONFIG_VIDEO_MOTION_MAX_BLOCKS)
+		return -EINVAL;
+
+	for (int by = 0; by < gh; by ++)
+	{
+		for (int bx = 0; bx < gw; bx ++)
+		{
+			for (int r = 0; r < BLOCK; r ++)
+			{
+				int y = (by * BLOCK + r) * CONFIG_VIDEO_MOTION_SCALE + CONFIG_VIDEO_MOTION_SCALE / 2;
+				const uint8_t* row = buffer + y * fmt->pitch;
+				int x = bx * BLOCK * CONFIG_VIDEO_MOTION_SCALE + CONFIG_VIDEO_MOTION_SCALE / 2;
+
+				for (int c = 0; c < BLOCK; c ++, x += CONFIG_VIDEO_MOTION_SCALE)
+				{
+					switch (fmt->pixelformat)
+					{
+					case VIDEO_PIX_FMT_YUYV:
+						*out ++ = row[x * 2];
+						break;
+					case VIDEO_PIX_FMT_RGB565:
+						*out ++ = _luma565(((const uint16_t*)row)[x]);
+						break;
+					case VIDEO_PIX_FMT_GREY:
+						*out ++ = row[x];
+						break;
+					default:
+						return -ENOTSUP;
+					}
+				}
+			}
+		}
+	}
+	return gw * gh;
+}
+
+int vmotion_process(const struct video_format* fmt, const uint8_t* buffer, uint32_t timestamp)
+{
+	struct handle* h = &vmotion;
+	uint32_t limit = h->threshold * BLOCK_SIZE;
+	int blocks, changed = 0;
+	uint8_t* swap;
+
+	blocks = _sample(h, fmt, buffer);
+	if (blocks < 0)
+		return blocks;
+
+	if (blocks == h->blocks)
+	{
+		for (int i = 0; i < blocks; i ++)
+		{
+			if (_sad(h->cur + i * BLOCK_SIZE, h->prev + i * BLOCK_SIZE) > limit)
+				changed ++;
+		}
+	}
+
+	swap = h->prev;
+	h->prev = h->cur;
+	h->cur = swap;
+	h->blocks = blocks;
+
+	if (changed >= h->min_blocks
+		&& k_uptime_get() - h->last_event >= CONFIG_VIDEO_MOTION_HOLDOFF_MS)
+	{
+		h->last_event = k_uptime_get();
+		k_mutex_lock(&event_lock, K_FOREVER);
+		h->events ++;
+		h->event.timestamp = timestamp;
+		h->event.blocks = changed;
+		h->event.total = blocks;
+		k_condvar_broadcast(&event_cond);
+		k_mutex_unlock(&event_lock);
+		LOG_DBG("motion %d/%d blocks", changed, blocks);
+	}
+	return changed;
+}
+
+int vmotion_wait(uint32_t* seen, struct vmotion_event* event, k_timeout_t timeout)
+{
+	struct handle* h = &vmotion;
+	k_timepoint_t end = sys_timepoint_calc(timeout);
+	uint32_t events;
+	int err = 0;
+
+	k_mutex_lock(&event_lock, K_FOREVER);
+	events = seen != NULL ? *seen : h->events;
+	while (events == h->events && err == 0)
+		err = k_condvar_wait(&event_cond, &event_lock, sys_timepoint_timeout(end));
+	if (events != h->events)
+	{
+		*event = h->event;
+		err = 0;
+	}
+	if (seen != NULL)
+		*seen = h->events;
+	k_mutex_unlock(&event_lock);
+	return err;
+}
+
+uint32_t vmotion_events(void)
+{
+	return vmotion.events;
+}
+
+void vmotion_config(int threshold, int min_blocks)
+{
+	vmotion.threshold = CLAMP(threshold, 1, 255);
+	vmotion.min_blocks = MAX(min_blocks, 1);
+}
+
+#if CONFIG_ZTEST
+/* the block kernels for tests/app/vmotion */
+uint32_t vmotion_sad(const uint8_t* a, const uint8_t* b)
+{
+	return _sad(a, b);
+}
+
+uint32_t vmotion_sad_swar(const uint8_t* a, const uint8_t* b)
+{
+	return _sad_swar(a, b);
+}
+#endif
+
+#if CONFIG_HU_PACKET
+/*
+ * motion: events, threshold, min blocks
+ * motion set <threshold> <min blocks>
+ * motion poll <events>: events, timestamp, blocks, total of the latest event
+ *   after the count the caller last saw, NAK -EAGAIN when there is none. The
+ *   server thread is shared by every link, so it never waits for motion.
+ */
+static void _motion(void* hup, int argc, const char** argv)
+{
+	struct handle* h = &vmotion;
+	struct vmotion_event event;
+	int err;
+
+	if (argc > 3 && strcmp(argv[1], "set") == 0)
+	{
+		vmotion_config(strtol(argv[2], NULL, 0), strtol(argv[3], NULL, 0));
+	}
+	else if (argc > 2 && strcmp(argv[1], "poll") == 0)
+	{
+		uint32_t seen = strtoul(argv[2], NULL, 0);
+
+		err = vmotion_wait(&seen, &event, K_NO_WAIT);
+		if (err != 0)
+		{
+			hupacket_nak_response(hup, NULL, err);
+			hupacket_send_buffer(hup, NULL);
+			return;
+		}
+		hupacket_ack_response(hup, NULL);
+		hupacket_record_int(hup, NULL, seen);
+		hupacket_record_int(hup, NULL, event.timestamp);
+		hupacket_record_int(hup, NULL, event.blocks);
+		hupacket_record_int(hup, NULL, event.total);
+		hupacket_send_buffer(hup, NULL);
+		return;
+	}
+
+	hupacket_ack_response(hup, NULL);
+	hupacket_record_int(hup, NULL, h->events);
+	hupacket_record_int(hup, NULL, h->threshold);
+	hupacket_record_int(hup, NULL, h->min_blocks);
+	hupacket_send_buffer(hup, NULL);
+}
+DEFINE_HUP_CMD(hup_cmd_motion, "motion", _motion);
+#endif
+#endif
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Video pipeline counters: frames shown, frames skipped because the display
+ * fell behind, capture to display latency from the driver timestamp,
+ * dequeue to display time, and how many buffers the driver had queued when
+ * a frame was dequeued. A queue depth of 0 means capture was starved and
+ * more buffers (and VIDEO_BUFFER_POOL_HEAP_SIZE) would help.
+ */
+
+#include "main.h"
+
+#include <hu/hupacket.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/logging/log.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#if CONFIG_VIDEO_STATS
+LOG_MODULE_REGISTER(vstats, CONFIG_LOG_DEFAULT_LEVEL);
+
+struct vstats
+{
+	uint32_t frames;
+	uint32_t skipped;
+	uint32_t late;
+	uint32_t errors;
+	int64_t start;
+
+	/* capture timestamp to display done, ms */
+	uint32_t lat_min;
+	uint32_t lat_max;
+	uint64_t lat_total;
+
+	/* dequeue to display done, cycles */
+	uint32_t show_min;
+	uint32_t show_max;
+	uint64_t show_total;
+
+	/* buffers left in the driver at dequeue */
+	uint32_t dequeues;
+	int queued;
+	int depth_min;
+	int depth_max;
+};
+
+static struct vstats stats;
+static struct k_spinlock stats_lock;
+
+void vstats_queued(int delta)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	stats.queued += delta;
+	if (delta < 0)
+	{
+		if (stats.dequeues ++ == 0 || stats.queued < stats.depth_min)
+			stats.depth_min = stats.queued;
+		if (stats.queued > stats.depth_max)
+			stats.depth_max = stats.queued;
+	}
+	k_spin_unlock(&stats_lock, key);
+}
+
+void vstats_skipped(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+	stats.skipped ++;
+	k_spin_unlock(&stats_lock, key);
+}
+
+void vstats_error(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+	stats.errors ++;
+	k_spin_unlock(&stats_lock, key);
+}
+
+void vstats_shown(uint32_t timestamp, uint32_t dequeued)
+{
+	uint32_t latency = k_uptime_get_32() - timestamp;
+	uint32_t show = k_cycle_get_32() - dequeued;
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	if (stats.frames == 0)
+	{
+		stats.start = k_uptime_get();
+		stats.lat_min = latency;
+		stats.show_min = show;
+	}
+	stats.lat_min = MIN(stats.lat_min, latency);
+	stats.lat_max = MAX(stats.lat_max, latency);
+	stats.lat_total += latency;
+	stats.show_min = MIN(stats.show_min, show);
+	stats.show_max = MAX(stats.show_max, show);
+	stats.show_total += show;
+	if (latency > CONFIG_VIDEO_STATS_LATE_MS)
+		stats.late ++;
+	stats.frames ++;
+	k_spin_unlock(&stats_lock, key);
+}
+
+static void _reset(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+	int queued = stats.queued;
+
+	memset(&stats, 0, sizeof(stats));
+	stats.queued = queued;
+	k_spin_unlock(&stats_lock, key);
+}
+
+/* "frames,fps x10,skipped,late,errors,lat min:avg:max ms,show min:avg:max us,depth min:max" */
+static void _format(char* buffer, size_t size)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+	struct vstats s = stats;
+	k_spin_unlock(&stats_lock, key);
+	int64_t elapsed = s.frames ? k_uptime_get() - s.start : 0;
+
+	snprintf(buffer, size, "%u,%u,%u,%u,%u,%u:%u:%u,%u:%u:%u,%d:%d"
+		, s.frames, elapsed > 0 ? (uint32_t)(s.frames * 10000LL / elapsed) : 0
+		, s.skipped, s.late, s.errors
+		, s.lat_min, s.frames ? (uint32_t)(s.lat_total / s.frames) : 0, s.lat_max
+		, k_cyc_to_us_floor32(s.show_min)
+		, s.frames ? (uint32_t)k_cyc_to_us_floor64(s.show_total / s.frames) : 0
+		, k_cyc_to_us_floor32(s.show_max)
+		, s.depth_min, s.depth_max);
+}
+
+#if CONFIG_HU_PACKET
+/* video stats [reset] | video reset: one record, see _format */
+static void _video(void* h, int argc, const char** argv)
+{
+	char record[96];
+
+	if (argc > 1 && strcmp(argv[1], "reset") == 0)
+	{
+		_reset();
+		hupacket_ack_response(h, NULL);
+		hupacket_send_buffer(h, NULL);
+		return;
+	}
+	if (argc < 2 || strcmp(argv[1], "stats") != 0)
+	{
+		hupacket_nak_response(h, NULL, -EINVAL);
+		hupacket_send_buffer(h, NULL);
+		return;
+	}
+
+	_format(record, sizeof(record));
+	hupacket_ack_response(h, NULL);
+	hupacket_record_str(h, NULL, record);
+	hupacket_send_buffer(h, NULL);
+
+	if (argc > 2 && strcmp(argv[2], "reset") == 0)
+		_reset();
+}
+DEFINE_HUP_CMD(hup_cmd_video, "video", _video);
+#endif
+
+#if CONFIG_SHELL
+static int _shell_vstats(const struct shell* sh, size_t argc, char** argv)
+{
+	char record[96];
+
+	if (argc > 1 && strcmp(argv[1], "reset") == 0)
+	{
+		_reset();
+		return 0;
+	}
+
+	_format(record, sizeof(record));
+	shell_print(sh, "frames,fps x10,skipped,late,errors,latency min:avg:max ms"
+		",show min:avg:max us,queue depth min:max");
+	shell_print(sh, "%s", record);
+	return 0;
+}
+SHELL_CMD_ARG_REGISTER(vstats, NULL, "Video pipeline counters [reset]", _shell_vstats, 1, 1);
+#endif
+#endif
@@ -0,0 +1,429 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "main.h"
+
+#include <hu/hupacket.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/video.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/posix/sys/socket.h>
+#include <zephyr/posix/unistd.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/logging/log.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if CONFIG_VIDEO_STREAM
+LOG_MODULE_REGISTER(vstream, CONFIG_LOG_DEFAULT_LEVEL);
+
+/*
+ * Every captured frame is cut into fragments of up to
+ * VIDEO_STREAM_FRAGMENT_SIZE bytes, each one a datagram (or a record on
+ * TCP) starting with this little endian header. Fragments carry the raw
+ * byte offset they cover, so with RLE the host still knows where every
+ * fragment goes and a lost datagram only leaves a hole in one frame.
+ */
+#define VSTREAM_MAGIC		0x53435548	// "HUCS"
+#define VSTREAM_FLAG_RLE	BIT(0)
+#define VSTREAM_FLAG_LAST	BIT(1)
+
+struct vstream_hdr
+{
+	uint32_t magic;
+	uint16_t frame;
+	uint16_t fragment;
+	uint16_t flags;
+	uint16_t width;
+	uint16_t height;
+	uint16_t pitch;
+	uint32_t pixelformat;
+	uint32_t size;			// raw frame size
+	uint32_t offset;		// raw offset of this fragment
+	uint32_t length;		// raw bytes of this fragment
+	uint32_t timestamp;		// capture time in ms
+} __packed;
+
+#define FRAGMENT_PAYLOAD	(CONFIG_VIDEO_STREAM_FRAGMENT_SIZE - sizeof(struct vstream_hdr))
+#define SEND_RETRIES		20
+
+/* a frame, or without vbuf a new peer (AF_UNSPEC to close the stream) */
+struct item
+{
+	struct video_buffer* vbuf;
+	struct video_format fmt;
+	struct sockaddr_in peer;
+};
+
+struct handle
+{
+	const struct device* video_dev;
+	struct k_msgq queue;
+	struct item queue_buffer[CONFIG_VIDEO_STREAM_QUEUE];
+
+	int sock;				// socket and peer belong to the stream thread
+	struct sockaddr_in peer;
+	bool enabled;
+	atomic_t pending;		// frames submitted and not yet given back
+	uint16_t frame;
+	int64_t last_frame;
+
+	uint32_t frames;
+	uint32_t fragments;
+	uint32_t skipped;
+	uint32_t dropped;
+	uint64_t bytes;
+
+	uint8_t tx[CONFIG_VIDEO_STREAM_FRAGMENT_SIZE] __aligned(4);
+};
+
+static struct handle vstream;
+
+K_KERNEL_STACK_DEFINE(vstream_stack, CONFIG_VIDEO_STREAM_STACK_SIZE);
+static struct k_thread vstream_thread;
+
+#if CONFIG_VIDEO_STREAM_RLE
+/*
+ * PackBits on 16 bit pixels: a control byte c < 128 is followed by c + 1
+ * literal pixels, c >= 128 by one pixel repeated c - 126 times. Encodes
+ * until the input or the output runs out, returns the output size and the
+ * consumed pixels.
+ */
+static size_t _rle_encode(const uint16_t* src, size_t pixels, uint8_t* dst, size_t dst_size
+	, size_t* consumed)
+{
+	size_t in = 0, out = 0;
+
+	while (in < pixels)
+	{
+		size_t run = 1;
+
+		while (in + run < pixels && run < 129 && src[in + run] == src[in])
+			run ++;
+
+		if (run >= 2)
+		{
+			if (out + 3 > dst_size)
+				break;
+			dst[out ++] = run + 126;
+			memcpy(&dst[out], &src[in], 2);
+			out += 2;
+			in += run;
+			continue;
+		}
+
+		/* literal block up to the next run of two */
+		size_t lit = 1;
+		while (in + lit < pixels && lit < 128
+			&& !(in + lit + 1 < pixels && src[in + lit] == src[in + lit + 1]))
+			lit ++;
+		if (out + 1 + 2 * lit > dst_size)
+		{
+			if (out + 3 > dst_size)
+				break;
+			lit = (dst_size - out - 1) / 2;
+		}
+		dst[out ++] = lit - 1;
+		memcpy(&dst[out], &src[in], 2 * lit);
+		out += 2 * lit;
+		in += lit;
+	}
+
+	*consumed = in;
+	return out;
+}
+#endif
+
+static int _connect(struct handle* h)
+{
+	int sock;
+
+	if (h->sock >= 0)
+		return 0;
+	/* a frame that raced with vstream off */
+	if (h->peer.sin_family != AF_INET)
+		return -ENOTCONN;
+
+#if CONFIG_VIDEO_STREAM_TCP
+	sock = zsock_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+#else
+	sock = zsock_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#endif
+	if (sock < 0)
+	{
+		LOG_ERR("Failed to create socket: %d", errno);
+		return -errno;
+	}
+
+	if (zsock_connect(sock, (struct sockaddr*)&h->peer, sizeof(h->peer)) < 0)
+	{
+		int err = -errno;
+
+		LOG_ERR("Failed to connect stream peer: %d", err);
+		zsock_close(sock);
+		return err;
+	}
+
+	h->sock = sock;
+	return 0;
+}
+
+static void _disconnect(struct handle* h)
+{
+	if (h->sock >= 0)
+	{
+		zsock_close(h->sock);
+		h->sock = -1;
+	}
+}
+
+/*
+ * Waits for tx buffers instead of failing when the stack is out of them. A
+ * TCP send may take only part of the fragment, the rest goes in the next.
+ */
+static int _send(struct handle* h, size_t len)
+{
+	size_t sent = 0;
+	int retry = 0;
+
+	while (sent < len)
+	{
+		ssize_t ret = zsock_send(h->sock, h->tx + sent, len - sent, 0);
+
+		if (ret >= 0)
+		{
+			sent += ret;
+			continue;
+		}
+		if (errno != ENOMEM && errno != EAGAIN && errno != ENOBUFS)
+			return -errno;
+		if (++ retry == SEND_RETRIES)
+			return -ENOBUFS;
+		k_usleep(CONFIG_VIDEO_STREAM_PACE_US + 500);
+	}
+	return 0;
+}
+
+static int _stream_frame(struct handle* h, struct item* item)
+{
+	struct vstream_hdr* hdr = (struct vstream_hdr*)h->tx;
+	const uint8_t* data = item->vbuf->buffer;
+	size_t size = item->vbuf->bytesused;
+	size_t offset = 0;
+	uint16_t fragment = 0;
+	int err;
+
+	if ((err = _connect(h)) != 0)
+		return err;
+
+	while (offset < size)
+	{
+		size_t length, payload;
+
+#if CONFIG_VIDEO_STREAM_RLE
+		if (video_bits_per_pixel(item->fmt.pixelformat) == 16 && size - offset >= 2)
+		{
+			size_t pixels;
+
+			payload = _rle_encode((const uint16_t*)(data + offset), (size - offset) / 2
+				, h->tx + sizeof(*hdr), FRAGMENT_PAYLOAD, &pixels);
+			length = pixels * 2;
+			hdr->flags = sys_cpu_to_le16(VSTREAM_FLAG_RLE);
+		}
+		else
+#endif
+		{
+			length = payload = MIN(size - offset, FRAGMENT_PAYLOAD);
+			memcpy(h->tx + sizeof(*hdr), data + offset, payload);
+			hdr->flags = 0;
+		}
+		if (offset + length >= size)
+			hdr->flags |= sys_cpu_to_le16(VSTREAM_FLAG_LAST);
+
+		hdr->magic = sys_cpu_to_le32(VSTREAM_MAGIC);
+		hdr->frame = sys_cpu_to_le16(h->frame);
+		hdr->fragment = sys_cpu_to_le16(fragment);
+		hdr->width = sys_cpu_to_le16(item->fmt.width);
+		hdr->height = sys_cpu_to_le16(item->fmt.height);
+		hdr->pitch = sys_cpu_to_le16(item->fmt.pitch);
+		hdr->pixelformat = sys_cpu_to_le32(item->fmt.pixelformat);
+		hdr->size = sys_cpu_to_le32(size);
+		hdr->offset = sys_cpu_to_le32(offset);
+		hdr->length = sys_cpu_to_le32(length);
+		hdr->timestamp = sys_cpu_to_le32(item->vbuf->timestamp);
+
+		if ((err = _send(h, sizeof(*hdr) + payload)) != 0)
+			return err;
+
+		h->fragments ++;
+		h->bytes += sizeof(*hdr) + payload;
+		offset += length;
+		fragment ++;
+
+		/* let the stack drain its tx buffers between bursts */
+		if ((fragment % CONFIG_VIDEO_STREAM_BURST) == 0)
+			k_usleep(CONFIG_VIDEO_STREAM_PACE_US);
+	}
+	return 0;
+}
+
+static void _vstream(void* arg1, void* arg2, void* arg3)
+{
+	struct handle* h = arg1;
+	struct item item;
+	int err;
+
+	while (1)
+	{
+		k_msgq_get(&h->queue, &item, K_FOREVER);
+
+		/* the peer changed or the stream was turned off */
+		if (item.vbuf == NULL)
+		{
+			_disconnect(h);
+			h->peer = item.peer;
+			continue;
+		}
+
+		err = _stream_frame(h, &item);
+		/* the last fragment is queued, the frame is no longer needed */
+		camera_enqueue(h->video_dev, item.vbuf);
+		atomic_dec(&h->pending);
+
+		if (err != 0)
+		{
+			h->dropped ++;
+			LOG_ERR("Frame %u dropped: %d", h->frame, err);
+			_disconnect(h);
+		}
+		else
+		{
+			h->frames ++;
+		}
+		h->frame ++;
+	}
+}
+
+/* hands the new peer to the stream thread behind the frames already queued */
+static int _set_peer(struct handle* h, const char* addr, int port)
+{
+	struct item item = { .peer = { .sin_family = AF_INET, .sin_port = htons(port) } };
+	bool enabled = h->enabled;
+
+	if (zsock_inet_pton(AF_INET, addr, &item.peer.sin_addr) != 1)
+		return -EINVAL;
+
+	/* no frames are queued behind the peer change, the old peer stays on failure */
+	h->enabled = false;
+	if (k_msgq_put(&h->queue, &item, K_MSEC(1000)) != 0)
+	{
+		h->enabled = enabled;
+		return -EBUSY;
+	}
+	h->enabled = true;
+	LOG_INF("Streaming to %s:%d", addr, port);
+	return 0;
+}
+
+static int _stop(struct handle* h)
+{
+	struct item item = { .peer = { .sin_family = AF_UNSPEC } };
+
+	h->enabled = false;
+	return k_msgq_put(&h->queue, &item, K_MSEC(1000)) != 0 ? -EBUSY : 0;
+}
+
+int vstream_submit(struct video_buffer* vbuf, const struct video_format* fmt)
+{
+	struct handle* h = &vstream;
+	struct item item = { .vbuf = vbuf, .fmt = *fmt };
+	int64_t now = k_uptime_get();
+
+	if (!h->enabled || h->video_dev == NULL)
+		return -ENOTCONN;
+
+	/* cap the frame rate, the display keeps running at full speed */
+	if (now - h->last_frame < 1000 / CONFIG_VIDEO_STREAM_MAX_FPS)
+		return -EAGAIN;
+
+	atomic_inc(&h->pending);
+	if (k_msgq_put(&h->queue, &item, K_NO_WAIT) != 0)
+	{
+		atomic_dec(&h->pending);
+		h->skipped ++;
+		return -EBUSY;
+	}
+	h->last_frame = now;
+	return 0;
+}
+
+void vstream_sync(void)
+{
+	/* the camera releases its buffers only once the stream gave them back */
+	while (atomic_get(&vstream.pending) != 0)
+		k_msleep(5);
+}
+
+int init_vstream(const struct device* video_dev)
+{
+	struct handle* h = &vstream;
+
+	h->video_dev = video_dev;
+	h->sock = -1;
+	k_msgq_init(&h->queue, (char*)h->queue_buffer, sizeof(struct item), CONFIG_VIDEO_STREAM_QUEUE);
+
+	if (strlen(CONFIG_VIDEO_STREAM_HOST) > 0)
+		_set_peer(h, CONFIG_VIDEO_STREAM_HOST, CONFIG_VIDEO_STREAM_PORT);
+
+	k_thread_create(&vstream_thread, vstream_stack, K_KERNEL_STACK_SIZEOF(vstream_stack)
+		, _vstream, h, NULL, NULL, CONFIG_VIDEO_STREAM_PRIORITY, 0, K_NO_WAIT);
+	k_thread_name_set(&vstream_thread, "vstream");
+	return 0;
+}
+
+#if CONFIG_HU_PACKET
+/* vstream [<ip> [port]|off]: set the stream peer or report the counters */
+static void _vstream_cmd(void* hup, int argc, const char** argv)
+{
+	struct handle* h = &vstream;
+	char record[64];
+	int err = 0;
+
+	if (argc > 1 && strcmp(argv[1], "off") == 0)
+	{
+		err = _stop(h);
+	}
+	else if (argc > 1)
+	{
+		int port = argc > 2 ? strtol(argv[2], NULL, 0) : CONFIG_VIDEO_STREAM_PORT;
+
+		err = _set_peer(h, argv[1], port);
+	}
+	if (err != 0)
+	{
+		hupacket_nak_response(hup, NULL, err);
+		hupacket_send_buffer(hup, NULL);
+		return;
+	}
+
+	hupacket_ack_response(hup, NULL);
+	hupacket_record_int(hup, NULL, h->enabled);
+	hupacket_record_int(hup, NULL, h->frames);
+	hupacket_record_int(hup, NULL, h->fragments);
+	hupacket_record_int(hup, NULL, h->skipped);
+	hupacket_record_int(hup, NULL, h->dropped);
+	snprintf(record, sizeof(record), "%llu", h->bytes);
+	hupacket_record_str(hup, NULL, record);
+	hupacket_send_buffer(hup, NULL);
+}
+DEFINE_HUP_CMD(hup_cmd_vstream, "vstream", _vstream_cmd);
+#endif
+#endif
@@ -13,13 +13,33 @@
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/slist.h>
 
 #include <app/drivers/blink.h>
 
 LOG_MODULE_REGISTER(blink_gpio_led, CONFIG_BLINK_LOG_LEVEL);
 
-struct blink_gpio_led_data {
+/*
+ * LEDs on the same GPIO port share one timer. Each expiry toggles every LED
+ * that is due with a single gpio_port_toggle_bits() call and rearms the
+ * timer for the earliest next deadline, so the interrupt load does not grow
+ * with the number of LEDs. Deadlines are aligned to multiples of the
+ * period, LEDs with the same period toggle on the same tick.
+ */
+struct blink_gpio_led_wheel {
+	const struct device *port;
+	sys_slist_t leds;
 	struct k_timer timer;
+	struct k_spinlock lock;
+};
+
+struct blink_gpio_led_data {
+	sys_snode_t node;
+	struct blink_gpio_led_wheel *wheel;
+	gpio_port_pins_t pin;
+	k_ticks_t period;	/* 0 when not blinking */
+	k_ticks_t next;
 };
 
 struct blink_gpio_led_config {
@@ -27,16 +47,61 @@ struct blink_gpio_led_config {
 	unsigned int period_ms;
 };
 
+static struct blink_gpio_led_wheel wheels[DT_NUM_INST_STATUS_OKAY(DT_DRV_COMPAT)];
+
+/* called with the wheel lock held */
+static void blink_gpio_led_schedule(struct blink_gpio_led_wheel *wheel, k_ticks_t now)
+{
+	struct blink_gpio_led_data *data;
+	/* k_ticks_t is unsigned without CONFIG_TIMEOUT_64BIT, no -1 marker */
+	bool blinking = false;
+	k_ticks_t next = 0;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&wheel->leds, data, node) {
+		if (data->period > 0 && (!blinking || data->next < next)) {
+			next = data->next;
+			blinking = true;
+		}
+	}
+
+	if (!blinking) {
+		k_timer_stop(&wheel->timer);
+	} else {
+		k_timer_start(&wheel->timer, K_TICKS(next > now ? next - now : 0), K_NO_WAIT);
+	}
+}
+
 static void blink_gpio_led_on_timer_expire(struct k_timer *timer)
 {
-	const struct device *dev = k_timer_user_data_get(timer);
-	const struct blink_gpio_led_config *config = dev->config;
+	struct blink_gpio_led_wheel *wheel =
+		CONTAINER_OF(timer, struct blink_gpio_led_wheel, timer);
+	k_spinlock_key_t key = k_spin_lock(&wheel->lock);
+	k_ticks_t now = k_uptime_ticks();
+	struct blink_gpio_led_data *data;
+	gpio_port_pins_t pins = 0;
 	int ret;
 
-	ret = gpio_pin_toggle_dt(&config->led);
-	if (ret < 0) {
-		LOG_ERR("Could not toggle LED GPIO (%d)", ret);
+	SYS_SLIST_FOR_EACH_CONTAINER(&wheel->leds, data, node) {
+		if (data->period == 0 || data->next > now) {
+			continue;
+		}
+		pins |= data->pin;
+		data->next += data->period;
+		if (data->next <= now) {
+			/* fell behind, skip the missed toggles */
+			data->next = (now / data->period + 1) * data->period;
+		}
+	}
+
+	if (pins != 0) {
+		ret = gpio_port_toggle_bits(wheel->port, pins);
+		if (ret < 0) {
+			LOG_ERR("Could not toggle LED GPIOs (%d)", ret);
+		}
 	}
+
+	blink_gpio_led_schedule(wheel, now);
+	k_spin_unlock(&wheel->lock, key);
 }
 
 static int blink_gpio_led_set_period_ms(const struct device *dev,
@@ -44,14 +109,21 @@ static int blink_gpio_led_set_period_ms(const struct device *dev,
 {
 	const struct blink_gpio_led_config *config = dev->config;
 	struct blink_gpio_led_data *data = dev->data;
+	struct blink_gpio_led_wheel *wheel = data->wheel;
+	k_spinlock_key_t key = k_spin_lock(&wheel->lock);
+	k_ticks_t now = k_uptime_ticks();
+
+	data->period = period_ms > 0 ? MAX(k_ms_to_ticks_ceil64(period_ms), 1) : 0;
+	if (data->period > 0) {
+		data->next = (now / data->period + 1) * data->period;
+	}
+	blink_gpio_led_schedule(wheel, now);
+	k_spin_unlock(&wheel->lock, key);
 
 	if (period_ms == 0) {
-		k_timer_stop(&data->timer);
 		return gpio_pin_set_dt(&config->led, 0);
 	}
 
-	k_timer_start(&data->timer, K_MSEC(period_ms), K_MSEC(period_ms));
-
 	return 0;
 }
 
@@ -59,10 +131,28 @@ static DEVICE_API(blink, blink_gpio_led_api) = {
 	.set_period_ms = &blink_gpio_led_set_period_ms,
 };
 
+static struct blink_gpio_led_wheel *blink_gpio_led_wheel_get(const struct device *port)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(wheels); i++) {
+		if (wheels[i].port == port) {
+			return &wheels[i];
+		}
+		if (wheels[i].port == NULL) {
+			wheels[i].port = port;
+			sys_slist_init(&wheels[i].leds);
+			k_timer_init(&wheels[i].timer, blink_gpio_led_on_timer_expire, NULL);
+			return &wheels[i];
+		}
+	}
+
+	return NULL;
+}
+
 static int blink_gpio_led_init(const struct device *dev)
 {
 	const struct blink_gpio_led_config *config = dev->config;
 	struct blink_gpio_led_data *data = dev->data;
+	k_spinlock_key_t key;
 	int ret;
 
 	if (!gpio_is_ready_dt(&config->led)) {
@@ -76,12 +166,17 @@ static int blink_gpio_led_init(const struct device *dev)
 		return ret;
 	}
 
-	k_timer_init(&data->timer, blink_gpio_led_on_timer_expire, NULL);
-	k_timer_user_data_set(&data->timer, (void *)dev);
+	/* one wheel per instance at most, so there is always one left */
+	data->wheel = blink_gpio_led_wheel_get(config->led.port);
+	data->pin = BIT(config->led.pin);
+	data->period = 0;
+
+	key = k_spin_lock(&data->wheel->lock);
+	sys_slist_append(&data->wheel->leds, &data->node);
+	k_spin_unlock(&data->wheel->lock, key);
 
 	if (config->period_ms > 0) {
-		k_timer_start(&data->timer, K_MSEC(config->period_ms),
-			      K_MSEC(config->period_ms));
+		blink_gpio_led_set_period_ms(dev, config->period_ms);
 	}
 
 	return 0;
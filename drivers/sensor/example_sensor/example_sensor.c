@@ -8,12 +8,48 @@
 #include <zephyr/device.h>
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/drivers/sensor.h>
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/util.h>
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(example_sensor, CONFIG_SENSOR_LOG_LEVEL);
 
+#ifdef CONFIG_SENSOR_ASYNC_API
+/* one FIFO entry, also the layout of the samples in a read buffer */
+struct example_sensor_sample {
+	uint64_t timestamp_ns;
+	uint8_t state;
+} __packed;
+
+/* read buffer, decoded by the decoder below */
+struct example_sensor_encoded {
+	uint16_t count;
+	uint16_t events;	/* BIT() of the triggers that completed the read */
+	struct example_sensor_sample samples[];
+} __packed;
+#endif
+
 struct example_sensor_data {
 	int state;
+#ifdef CONFIG_SENSOR_ASYNC_API
+	const struct device *dev;
+	struct k_spinlock lock;
+	struct k_timer timer;
+	uint32_t rate_hz;	/* 0 when the sampler is stopped */
+	bool stream_rate;	/* the sampler was started by a stream read */
+
+	struct example_sensor_sample fifo[CONFIG_EXAMPLE_SENSOR_FIFO_SIZE];
+	uint16_t head;
+	uint16_t count;
+	uint32_t overruns;
+
+	/* pending stream read, completed from the sampler */
+	struct rtio_iodev_sqe *stream;
+	uint16_t threshold;
+	uint16_t triggers;
+	bool drop;
+#endif
 };
 
 struct example_sensor_config {
@@ -46,15 +82,361 @@ static int example_sensor_channel_get(const struct device *dev,
 	return 0;
 }
 
+#ifdef CONFIG_SENSOR_ASYNC_API
+/*
+ * A timer samples the input into a FIFO at the sampling frequency. One-shot
+ * reads return the whole FIFO with a timestamp per sample, or a single
+ * sample taken on the spot while the sampler is stopped. Stream reads
+ * complete from the sampler once the FIFO reaches the requested trigger.
+ * A sampler started by a stream read stops when the stream is not
+ * resubmitted or is cancelled.
+ */
+
+static void example_sensor_sampler_set(struct example_sensor_data *data,
+				       uint32_t rate_hz)
+{
+	data->rate_hz = rate_hz;
+	if (rate_hz == 0) {
+		k_timer_stop(&data->timer);
+	} else {
+		k_timer_start(&data->timer, K_USEC(USEC_PER_SEC / rate_hz),
+			      K_USEC(USEC_PER_SEC / rate_hz));
+	}
+}
+
+/* called with the lock held */
+static int example_sensor_drain(struct example_sensor_data *data,
+				struct rtio_iodev_sqe *iodev_sqe,
+				uint16_t events, bool drop)
+{
+	const uint32_t min_len = sizeof(struct example_sensor_encoded);
+	uint32_t ideal_len = min_len + data->count * sizeof(struct example_sensor_sample);
+	struct example_sensor_encoded *edata;
+	uint8_t *buf;
+	uint32_t buf_len;
+	uint16_t count;
+	int ret;
+
+	ret = rtio_sqe_rx_buf(iodev_sqe, min_len, ideal_len, &buf, &buf_len);
+	if (ret < 0) {
+		return ret;
+	}
+
+	count = drop ? 0 : MIN(data->count, (buf_len - min_len) / sizeof(struct example_sensor_sample));
+	edata = (struct example_sensor_encoded *)buf;
+	edata->count = count;
+	edata->events = events;
+	for (uint16_t i = 0; i < count; i++) {
+		edata->samples[i] = data->fifo[data->head];
+		data->head = (data->head + 1) % ARRAY_SIZE(data->fifo);
+	}
+	data->count -= count;
+
+	if (drop) {
+		data->count = 0;
+	}
+
+	return 0;
+}
+
+static void example_sensor_on_sample(struct k_timer *timer)
+{
+	struct example_sensor_data *data =
+		CONTAINER_OF(timer, struct example_sensor_data, timer);
+	const struct example_sensor_config *config = data->dev->config;
+	struct rtio_iodev_sqe *stream = NULL;
+	k_spinlock_key_t key = k_spin_lock(&data->lock);
+	struct example_sensor_sample *sample;
+	uint16_t events = 0;
+	int ret = 0;
+
+	if (data->stream == NULL && data->stream_rate) {
+		/* the last stream completed and was not resubmitted */
+		data->stream_rate = false;
+		example_sensor_sampler_set(data, 0);
+		k_spin_unlock(&data->lock, key);
+		return;
+	}
+
+	if (data->count == ARRAY_SIZE(data->fifo)) {
+		/* full, the oldest sample is lost */
+		data->head = (data->head + 1) % ARRAY_SIZE(data->fifo);
+		data->count--;
+		data->overruns++;
+	}
+	sample = &data->fifo[(data->head + data->count) % ARRAY_SIZE(data->fifo)];
+	sample->timestamp_ns = k_ticks_to_ns_floor64(k_uptime_ticks());
+	sample->state = gpio_pin_get_dt(&config->input) > 0;
+	data->count++;
+
+	if (data->stream != NULL && FIELD_GET(RTIO_SQE_CANCELED, data->stream->sqe.flags)) {
+		/* released without data, the samples stay for the next read */
+		stream = data->stream;
+		data->stream = NULL;
+		ret = -ECANCELED;
+	} else if (data->stream != NULL && data->count >= data->threshold) {
+		events |= BIT(SENSOR_TRIG_DATA_READY);
+		if (data->count >= CONFIG_EXAMPLE_SENSOR_FIFO_WATERMARK) {
+			events |= BIT(SENSOR_TRIG_FIFO_WATERMARK);
+		}
+		if (data->count == ARRAY_SIZE(data->fifo)) {
+			events |= BIT(SENSOR_TRIG_FIFO_FULL);
+		}
+		stream = data->stream;
+		data->stream = NULL;
+		ret = example_sensor_drain(data, stream, events & data->triggers, data->drop);
+	}
+	k_spin_unlock(&data->lock, key);
+
+	/* completing may resubmit the stream, so not under the lock */
+	if (stream == NULL) {
+		return;
+	}
+	if (ret < 0) {
+		rtio_iodev_sqe_err(stream, ret);
+	} else {
+		rtio_iodev_sqe_ok(stream, 0);
+	}
+}
+
+static int example_sensor_submit_stream(const struct device *dev,
+					struct rtio_iodev_sqe *iodev_sqe)
+{
+	const struct sensor_read_config *cfg = iodev_sqe->sqe.iodev->data;
+	struct example_sensor_data *data = dev->data;
+	uint16_t threshold = ARRAY_SIZE(data->fifo);
+	uint16_t triggers = 0;
+	bool drop = false;
+	k_spinlock_key_t key;
+
+	for (size_t i = 0; i < cfg->count; i++) {
+		switch (cfg->triggers[i].trigger) {
+		case SENSOR_TRIG_DATA_READY:
+			threshold = 1;
+			break;
+		case SENSOR_TRIG_FIFO_WATERMARK:
+			threshold = MIN(threshold, CONFIG_EXAMPLE_SENSOR_FIFO_WATERMARK);
+			break;
+		case SENSOR_TRIG_FIFO_FULL:
+			break;
+		default:
+			return -ENOTSUP;
+		}
+		triggers |= BIT(cfg->triggers[i].trigger);
+		drop |= cfg->triggers[i].opt == SENSOR_STREAM_DATA_DROP;
+	}
+
+	key = k_spin_lock(&data->lock);
+	data->stream = iodev_sqe;
+	data->threshold = threshold;
+	data->triggers = triggers;
+	data->drop = drop;
+	if (data->rate_hz == 0) {
+		example_sensor_sampler_set(data, CONFIG_EXAMPLE_SENSOR_SAMPLE_RATE_HZ);
+		data->stream_rate = true;
+	}
+	k_spin_unlock(&data->lock, key);
+
+	return 0;
+}
+
+static int example_sensor_submit_one_shot(const struct device *dev,
+					  struct rtio_iodev_sqe *iodev_sqe)
+{
+	const struct sensor_read_config *cfg = iodev_sqe->sqe.iodev->data;
+	const struct example_sensor_config *config = dev->config;
+	struct example_sensor_data *data = dev->data;
+	k_spinlock_key_t key;
+	int ret;
+
+	for (size_t i = 0; i < cfg->count; i++) {
+		if (cfg->channels[i].chan_type != SENSOR_CHAN_PROX &&
+		    cfg->channels[i].chan_type != SENSOR_CHAN_ALL) {
+			return -ENOTSUP;
+		}
+	}
+
+	key = k_spin_lock(&data->lock);
+	if (data->rate_hz == 0 && data->count == 0) {
+		/* no sampler and nothing left from it, read the input now */
+		data->count = 1;
+		data->fifo[data->head].timestamp_ns = k_ticks_to_ns_floor64(k_uptime_ticks());
+		data->fifo[data->head].state = gpio_pin_get_dt(&config->input) > 0;
+	}
+	ret = example_sensor_drain(data, iodev_sqe, 0, false);
+	k_spin_unlock(&data->lock, key);
+
+	return ret;
+}
+
+static void example_sensor_submit(const struct device *dev,
+				  struct rtio_iodev_sqe *iodev_sqe)
+{
+	const struct sensor_read_config *cfg = iodev_sqe->sqe.iodev->data;
+	int ret;
+
+	if (cfg->is_streaming) {
+		ret = example_sensor_submit_stream(dev, iodev_sqe);
+		if (ret < 0) {
+			rtio_iodev_sqe_err(iodev_sqe, ret);
+		}
+		return;
+	}
+
+	ret = example_sensor_submit_one_shot(dev, iodev_sqe);
+	if (ret < 0) {
+		rtio_iodev_sqe_err(iodev_sqe, ret);
+	} else {
+		rtio_iodev_sqe_ok(iodev_sqe, 0);
+	}
+}
+
+static int example_sensor_decoder_get_frame_count(const uint8_t *buffer,
+						  struct sensor_chan_spec chan_spec,
+						  uint16_t *frame_count)
+{
+	const struct example_sensor_encoded *edata = (const struct example_sensor_encoded *)buffer;
+
+	if (chan_spec.chan_type != SENSOR_CHAN_PROX || chan_spec.chan_idx != 0) {
+		return -ENOTSUP;
+	}
+
+	*frame_count = edata->count;
+
+	return 0;
+}
+
+static int example_sensor_decoder_get_size_info(struct sensor_chan_spec chan_spec,
+						size_t *base_size, size_t *frame_size)
+{
+	if (chan_spec.chan_type != SENSOR_CHAN_PROX) {
+		return -ENOTSUP;
+	}
+
+	*base_size = sizeof(struct sensor_byte_data);
+	*frame_size = sizeof(struct sensor_byte_sample_data);
+
+	return 0;
+}
+
+static int example_sensor_decoder_decode(const uint8_t *buffer,
+					 struct sensor_chan_spec chan_spec,
+					 uint32_t *fit, uint16_t max_count, void *data_out)
+{
+	const struct example_sensor_encoded *edata = (const struct example_sensor_encoded *)buffer;
+	struct sensor_byte_data *out = data_out;
+	uint16_t count = 0;
+
+	if (chan_spec.chan_type != SENSOR_CHAN_PROX || chan_spec.chan_idx != 0) {
+		return -ENOTSUP;
+	}
+
+	if (*fit >= edata->count || max_count == 0) {
+		return 0;
+	}
+
+	out->header.base_timestamp_ns = edata->samples[*fit].timestamp_ns;
+	while (*fit < edata->count && count < max_count) {
+		const struct example_sensor_sample *sample = &edata->samples[*fit];
+		uint64_t delta = sample->timestamp_ns - out->header.base_timestamp_ns;
+
+		if (delta > UINT32_MAX) {
+			/* the next call starts from a new base timestamp */
+			break;
+		}
+		out->readings[count].timestamp_delta = (uint32_t)delta;
+		out->readings[count].is_near = sample->state;
+		count++;
+		(*fit)++;
+	}
+	out->header.reading_count = count;
+
+	return count;
+}
+
+static bool example_sensor_decoder_has_trigger(const uint8_t *buffer,
+					       enum sensor_trigger_type trigger)
+{
+	const struct example_sensor_encoded *edata = (const struct example_sensor_encoded *)buffer;
+
+	return trigger < 16 && (edata->events & BIT(trigger)) != 0;
+}
+
+SENSOR_DECODER_API_DT_DEFINE() = {
+	.get_frame_count = example_sensor_decoder_get_frame_count,
+	.get_size_info = example_sensor_decoder_get_size_info,
+	.decode = example_sensor_decoder_decode,
+	.has_trigger = example_sensor_decoder_has_trigger,
+};
+
+static int example_sensor_get_decoder(const struct device *dev,
+				      const struct sensor_decoder_api **decoder)
+{
+	ARG_UNUSED(dev);
+	*decoder = &SENSOR_DECODER_NAME();
+
+	return 0;
+}
+
+static int example_sensor_attr_set(const struct device *dev,
+				   enum sensor_channel chan,
+				   enum sensor_attribute attr,
+				   const struct sensor_value *val)
+{
+	struct example_sensor_data *data = dev->data;
+	k_spinlock_key_t key;
+
+	if (attr != SENSOR_ATTR_SAMPLING_FREQUENCY) {
+		return -ENOTSUP;
+	}
+	if (val->val1 < 0 || val->val1 > USEC_PER_SEC) {
+		return -EINVAL;
+	}
+
+	key = k_spin_lock(&data->lock);
+	/* the rate now belongs to the application, streams leave it running */
+	data->stream_rate = false;
+	example_sensor_sampler_set(data, val->val1);
+	k_spin_unlock(&data->lock, key);
+
+	return 0;
+}
+
+static int example_sensor_attr_get(const struct device *dev,
+				   enum sensor_channel chan,
+				   enum sensor_attribute attr,
+				   struct sensor_value *val)
+{
+	struct example_sensor_data *data = dev->data;
+
+	if (attr != SENSOR_ATTR_SAMPLING_FREQUENCY) {
+		return -ENOTSUP;
+	}
+
+	val->val1 = data->rate_hz;
+	val->val2 = 0;
+
+	return 0;
+}
+#endif /* CONFIG_SENSOR_ASYNC_API */
+
 static DEVICE_API(sensor, example_sensor_api) = {
 	.sample_fetch = &example_sensor_sample_fetch,
 	.channel_get = &example_sensor_channel_get,
+#ifdef CONFIG_SENSOR_ASYNC_API
+	.attr_set = &example_sensor_attr_set,
+	.attr_get = &example_sensor_attr_get,
+	.submit = &example_sensor_submit,
+	.get_decoder = &example_sensor_get_decoder,
+#endif
 };
 
 static int example_sensor_init(const struct device *dev)
 {
 	const struct example_sensor_config *config = dev->config;
-
+#ifdef CONFIG_SENSOR_ASYNC_API
+	struct example_sensor_data *data = dev->data;
+#endif
 	int ret;
 
 	if (!device_is_ready(config->input.port)) {
@@ -68,6 +450,11 @@ static int example_sensor_init(const struct device *dev)
 		return ret;
 	}
 
+#ifdef CONFIG_SENSOR_ASYNC_API
+	data->dev = dev;
+	k_timer_init(&data->timer, example_sensor_on_sample, NULL);
+#endif
+
 	return 0;
 }
 
@@ -18,12 +18,22 @@ struct app_api
     void (*deinit)(void* arg1);
     int (*recv)(void*, uint8_t*, size_t);
     int (*send)(void*, const uint8_t*, size_t);
+    /* optional: hupacket handle of the peer of the last recv, NULL for the server's own */
+    void* (*session)(void*);
+    /* optional zero-copy recv: borrow up to size bytes in place, release them with finish */
+    int (*claim)(void*, uint8_t**, size_t);
+    void (*finish)(void*, size_t);
 };
 
 extern const struct app_api udp_server;
+extern const struct app_api udp_zc_server;
+extern const struct app_api tcp_server;
 
 extern const struct app_api uart_interrupt;
 extern const struct app_api uart_async;
 extern const struct app_api uart_polling;
+extern const struct app_api uart_rs485;
+extern const struct app_api usb_acm;
+extern const struct app_api usb_bulk;
 
 #endif // __APP_API_H__
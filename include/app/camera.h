@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __CAMERA_H__
+#define __CAMERA_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+
+struct video_buffer;
+
+/* capture format, 0 keeps the default of the build */
+struct camera_config {
+	uint32_t pixelformat;
+	uint16_t width;
+	uint16_t height;
+};
+
+/* a captured frame lent to a client, valid until camera_release() */
+struct camera_frame {
+	struct video_buffer* vbuf;
+	const uint8_t* buffer;
+	size_t size;
+	uint32_t timestamp;
+	uint32_t pixelformat;
+	uint16_t width;
+	uint16_t height;
+	uint32_t pitch;
+};
+
+/*
+ * Camera to display service. Buffers are allocated on start and released on
+ * stop, so an idle camera holds no video memory. camera_start() returns once
+ * capture runs, or with the error of the format, buffers or stream start.
+ */
+int camera_init(void);
+int camera_start(void);
+int camera_stop(void);
+int camera_reconfigure(const struct camera_config* config);
+bool camera_running(void);
+void camera_get_config(struct camera_config* config);
+
+/*
+ * Borrow the next frame the capture loop would give back to the camera,
+ * without a copy. One frame at a time; capture continues on the other
+ * buffers until it is released.
+ */
+int camera_acquire(struct camera_frame* frame, k_timeout_t timeout);
+void camera_release(struct camera_frame* frame);
+
+#endif // __CAMERA_H__
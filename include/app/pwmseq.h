@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __PWMSEQ_H__
+#define __PWMSEQ_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <zephyr/drivers/pwm.h>
+
+/* one step of a sequence, period and pulse in ns */
+struct pwmseq_step {
+	uint32_t period;
+	uint32_t pulse;
+	uint32_t duration_us;
+};
+
+/*
+ * Plays steps on a PWM channel timed by a kernel timer, each step is written
+ * from the system work queue. The steps are copied, repeat 0 loops until
+ * stopped. A channel already playing is restarted with the new sequence, an
+ * invalid one returns -EINVAL and leaves it playing.
+ */
+int pwmseq_play(const struct device* dev, uint32_t channel, pwm_flags_t flags
+	, const struct pwmseq_step* steps, size_t count, int repeat);
+int pwmseq_stop(const struct device* dev, uint32_t channel);
+bool pwmseq_busy(const struct device* dev, uint32_t channel);
+
+#endif // __PWMSEQ_H__
@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __VCONVERT_H__
+#define __VCONVERT_H__
+
+#include <stdint.h>
+
+struct video_format;
+
+/*
+ * Converts a frame in YUYV, RGB24 or RGB565 to the RGB565 frame out with
+ * nearest neighbour scaling, rotated clockwise by 0, 90, 180 or 270
+ * degrees. out gives the size after rotation.
+ */
+int init_vconvert(void);
+int vconvert(const struct video_format* in, const uint8_t* src
+	, const struct video_format* out, uint8_t* dst, int rotation);
+
+#endif // __VCONVERT_H__
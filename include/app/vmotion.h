@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __VMOTION_H__
+#define __VMOTION_H__
+
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+struct video_format;
+
+struct vmotion_event {
+	uint32_t timestamp;		// capture time in ms
+	uint16_t blocks;		// changed blocks
+	uint16_t total;
+};
+
+/* compares the frame with the previous one, returns the changed blocks */
+int vmotion_process(const struct video_format* fmt, const uint8_t* buffer, uint32_t timestamp);
+
+/*
+ * Waits for a motion event after the one counted in *seen and updates it,
+ * so a caller waiting in slices or polling with K_NO_WAIT misses nothing.
+ * Start with the count from vmotion_events(), or pass NULL to wait for the
+ * next event. Returns -EAGAIN on timeout.
+ */
+int vmotion_wait(uint32_t* seen, struct vmotion_event* event, k_timeout_t timeout);
+uint32_t vmotion_events(void);
+void vmotion_config(int threshold, int min_blocks);
+
+#endif // __VMOTION_H__
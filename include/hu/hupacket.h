@@ -16,6 +16,7 @@
 #include <stdbool.h>
 
 #define RECV_BUFFER_SIZE    CONFIG_HU_PACKET_SIZE
+#define HUP_ADDRESS_SIZE    8
 
 #ifdef __cplusplus
 extern "C"
@@ -23,6 +24,20 @@ extern "C"
 #endif
 
 typedef ssize_t (*send_func)(void* h, const uint8_t* buffer, size_t size);
+/* true when the transport answered the command itself, it is not run then */
+typedef bool (*filter_func)(void* h, const char* cmd, const char* sequence);
+
+struct hup_stats
+{
+    uint32_t rx_bytes;
+    uint32_t tx_bytes;
+    uint32_t frames;
+    uint32_t crc_errors;                // frames dropped with -ENMCRC16
+    uint32_t overflows;                 // frames dropped for the buffer size
+    uint32_t send_errors;
+    uint32_t recv_errors;               // counted by the transport owner
+};
+
 struct hup_handle
 {
     int argc;
@@ -41,6 +56,18 @@ struct hup_handle
     char tx_buffer[CONFIG_HU_PACKET_SIZE];
     void* user_data;
     send_func send;
+    filter_func filter;
+
+    struct hup_stats* stats;            // own_stats unless shared with hupacket_set_stats
+    struct hup_stats own_stats;
+
+#if CONFIG_HU_PACKET_RS485
+    char address[HUP_ADDRESS_SIZE];     // node id on the bus, empty to accept every frame
+    bool id_pending;                    // id of the current frame not checked yet
+    bool broadcast;                     // current frame is for every node
+    uint16_t slot;                      // response slot for broadcast frames
+    int64_t eot;                        // ticks at the end of the current frame
+#endif
 };
 
 struct hup_cmd
@@ -69,6 +96,14 @@ void* init_hupacket(void* h, send_func send, void* user_data);
 void deinit_hupacket(void* h);
 void reset_hupacket(void* h);
 void process_hupacket(void* h, uint8_t* data, size_t data_len);
+void hupacket_set_stats(void* h, struct hup_stats* stats);
+void hupacket_set_filter(void* h, filter_func filter);
+#if CONFIG_HU_PACKET_RS485
+int hupacket_set_address(void* h, const char* address);
+#endif
+#if CONFIG_HU_PACKET_PROFILE
+void hupacket_profile(const struct hup_cmd* cmd, uint32_t cycles);
+#endif
 
 
 void hupacket_append_str(void* h, char* buffer, const char* str);
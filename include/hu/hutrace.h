@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __HUTRACE_H__
+#define __HUTRACE_H__
+
+/*
+ * Trace points of the hupacket pipeline, from byte arrival to the response
+ * on the wire. They are Zephyr named events, so any tracing backend records
+ * them (CTF, SEGGER SystemView). scripts/hup_trace.py turns a CTF capture
+ * into a latency breakdown per stage.
+ *
+ *   hup_uart_rx    bytes read by the UART ISR/DMA callback, ring size
+ *   hup_uart_tx    bytes sent by the UART ISR/DMA callback
+ *   hup_recv       bytes handed to the parser by hup_server, server
+ *   hup_frame      frame length, records, at the end of a frame
+ *   cmd:<name>     0 at handler begin, 1 at handler end, records
+ *   hup_send       response bytes before the transport send
+ *   hup_send_done  transport send result
+ */
+
+#if CONFIG_HU_PACKET_TRACE
+#include <zephyr/tracing/tracing.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define HUP_TRACE(name, arg0, arg1) \
+	sys_trace_named_event(name, (uint32_t)(uintptr_t)(arg0), (uint32_t)(uintptr_t)(arg1))
+
+#define HUP_TRACE_CMD(cmd, arg0, arg1) \
+	do { \
+		char _name[20]; \
+		snprintf(_name, sizeof(_name), "cmd:%s", cmd); \
+		sys_trace_named_event(_name, (uint32_t)(uintptr_t)(arg0), (uint32_t)(uintptr_t)(arg1)); \
+	} while (0)
+#else
+#define HUP_TRACE(name, arg0, arg1)		do { } while (0)
+#define HUP_TRACE_CMD(cmd, arg0, arg1)	do { } while (0)
+#endif
+
+#endif // __HUTRACE_H__
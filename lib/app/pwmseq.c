@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * PWM sequence player. A sequence is converted to timer cycles and kernel
+ * ticks when it is queued, the timer expiry then only moves to the next
+ * step and rearms itself at an absolute deadline, so playback does not
+ * drift. The step is written to the controller from the system work queue:
+ * pwm_set_cycles() may block on I2C or SPI attached controllers and must
+ * not run in the timer interrupt.
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(app, CONFIG_APP_LOG_LEVEL);
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/pwm.h>
+#include <zephyr/spinlock.h>
+
+#include <app/pwmseq.h>
+
+#include <errno.h>
+#include <string.h>
+
+struct step
+{
+	uint32_t period;		// cycles
+	uint32_t pulse;			// cycles
+	k_ticks_t ticks;
+};
+
+struct player
+{
+	const struct device* dev;
+	uint32_t channel;
+	pwm_flags_t flags;
+	struct k_timer timer;
+	struct k_work work;
+
+	struct step steps[CONFIG_HU_APP_PWMSEQ_MAX_STEPS];
+	size_t count;
+	size_t index;
+	int repeat;				// loops left, 0 loops until stopped
+	k_ticks_t deadline;
+	bool busy;
+};
+
+static struct player players[CONFIG_HU_APP_PWMSEQ_PLAYERS];
+static struct k_spinlock lock;
+
+/*
+ * Writes the current step, a step missed by a late work item is skipped.
+ * Also runs once the sequence ended, index is then left on the last step.
+ */
+static void _write(struct k_work* work)
+{
+	struct player* p = CONTAINER_OF(work, struct player, work);
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	struct step s = p->steps[p->index];
+	pwm_flags_t flags = p->flags;
+
+	k_spin_unlock(&lock, key);
+	pwm_set_cycles(p->dev, p->channel, s.period, s.pulse, flags);
+}
+
+/* called with the lock held, from the timer interrupt or pwmseq_play */
+static void _apply(struct player* p)
+{
+	const struct step* s = &p->steps[p->index];
+
+	k_work_submit(&p->work);
+#if CONFIG_TIMEOUT_64BIT
+	p->deadline += s->ticks;
+	k_timer_start(&p->timer, K_TIMEOUT_ABS_TICKS(p->deadline), K_NO_WAIT);
+#else
+	k_timer_start(&p->timer, K_TICKS(s->ticks), K_NO_WAIT);
+#endif
+}
+
+static void _expiry(struct k_timer* timer)
+{
+	struct player* p = CONTAINER_OF(timer, struct player, timer);
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	if (p->busy)
+	{
+		if (p->index + 1 < p->count)
+			p->index ++;
+		/* the output keeps the last step once the sequence ends */
+		else if (p->repeat > 0 && -- p->repeat == 0)
+			p->busy = false;
+		else
+			p->index = 0;
+
+		if (p->busy)
+			_apply(p);
+	}
+	k_spin_unlock(&lock, key);
+}
+
+static struct player* _find(const struct device* dev, uint32_t channel)
+{
+	for (int i = 0; i < ARRAY_SIZE(players); i ++)
+	{
+		if (players[i].dev == dev && players[i].channel == channel)
+			return &players[i];
+	}
+	return NULL;
+}
+
+/* the player of the channel, a free one bound to it on first use */
+static struct player* _claim(const struct device* dev, uint32_t channel)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	struct player* p = _find(dev, channel);
+
+	if (p == NULL && (p = _find(NULL, 0)) != NULL)
+	{
+		p->dev = dev;
+		p->channel = channel;
+		k_timer_init(&p->timer, _expiry, NULL);
+		k_work_init(&p->work, _write);
+	}
+	k_spin_unlock(&lock, key);
+	return p;
+}
+
+static void _halt(struct player* p)
+{
+	struct k_work_sync sync;
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	p->busy = false;
+	k_spin_unlock(&lock, key);
+	k_timer_stop(&p->timer);
+	k_work_cancel_sync(&p->work, &sync);
+}
+
+int pwmseq_play(const struct device* dev, uint32_t channel, pwm_flags_t flags
+	, const struct pwmseq_step* steps, size_t count, int repeat)
+{
+	struct player* p;
+	k_spinlock_key_t key;
+	uint64_t cycles_per_sec;
+	int err;
+
+	if (count == 0 || count > CONFIG_HU_APP_PWMSEQ_MAX_STEPS || repeat < 0)
+		return -EINVAL;
+
+	if (!device_is_ready(dev))
+		return -ENODEV;
+
+	err = pwm_get_cycles_per_sec(dev, channel, &cycles_per_sec);
+	if (err != 0)
+		return err;
+
+	/* a bad sequence leaves a playing one alone */
+	for (size_t i = 0; i < count; i ++)
+	{
+		if (steps[i].pulse > steps[i].period
+			|| steps[i].period * cycles_per_sec / NSEC_PER_SEC > UINT32_MAX)
+			return -EINVAL;
+	}
+
+	p = _claim(dev, channel);
+	if (p == NULL)
+	{
+		LOG_ERR("No free PWM sequence player for %s %u", dev->name, channel);
+		return -ENOMEM;
+	}
+
+	/* the timer and the work item are idle from here, the steps can be rewritten */
+	_halt(p);
+
+	for (size_t i = 0; i < count; i ++)
+	{
+		p->steps[i].period = steps[i].period * cycles_per_sec / NSEC_PER_SEC;
+		p->steps[i].pulse = steps[i].pulse * cycles_per_sec / NSEC_PER_SEC;
+		p->steps[i].ticks = MAX(k_us_to_ticks_ceil64(steps[i].duration_us), 1);
+	}
+
+	key = k_spin_lock(&lock);
+	p->flags = flags;
+	p->count = count;
+	p->index = 0;
+	p->repeat = repeat;
+	p->deadline = k_uptime_ticks();
+	p->busy = true;
+	_apply(p);
+	k_spin_unlock(&lock, key);
+	return 0;
+}
+
+int pwmseq_stop(const struct device* dev, uint32_t channel)
+{
+	struct player* p = _find(dev, channel);
+
+	if (p == NULL)
+		return -ENOENT;
+
+	_halt(p);
+	return 0;
+}
+
+bool pwmseq_busy(const struct device* dev, uint32_t channel)
+{
+	struct player* p = _find(dev, channel);
+
+	return p != NULL && p->busy;
+}
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <app/app_api.h>
+#include <hu/hupacket.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/posix/sys/socket.h>
+#include <zephyr/posix/unistd.h>
+#include <zephyr/logging/log.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdio.h>
+
+#if CONFIG_HU_APP_TCP
+LOG_MODULE_REGISTER(app_tcp, CONFIG_LOG_DEFAULT_LEVEL);
+
+#define ACCEPT_RETRY_MS		100
+
+/*
+ * One connection is served at a time, the hupacket stream parser already
+ * handles frames split over several reads. The parser is owned here so it
+ * can be reset whenever a new peer connects.
+ */
+struct handle
+{
+	int sock;
+	int client;
+	void* hup;
+};
+
+static void _setsockopt_tcp(int sock, int level, int name, int value, const char* str)
+{
+	if (setsockopt(sock, level, name, &value, sizeof(value)) < 0)
+		LOG_WRN("TCP: Failed to set %s %d", str, errno);
+}
+
+static void _setup_client(int sock)
+{
+#if CONFIG_HU_APP_TCP_NODELAY
+	_setsockopt_tcp(sock, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+#endif
+#if CONFIG_HU_APP_TCP_SNDBUF > 0
+	_setsockopt_tcp(sock, SOL_SOCKET, SO_SNDBUF, CONFIG_HU_APP_TCP_SNDBUF, "SO_SNDBUF");
+#endif
+#if CONFIG_HU_APP_TCP_RCVBUF > 0
+	_setsockopt_tcp(sock, SOL_SOCKET, SO_RCVBUF, CONFIG_HU_APP_TCP_RCVBUF, "SO_RCVBUF");
+#endif
+#if CONFIG_HU_APP_TCP_KEEPALIVE
+	_setsockopt_tcp(sock, SOL_SOCKET, SO_KEEPALIVE, 1, "SO_KEEPALIVE");
+	_setsockopt_tcp(sock, IPPROTO_TCP, TCP_KEEPIDLE, CONFIG_HU_APP_TCP_KEEPIDLE, "TCP_KEEPIDLE");
+	_setsockopt_tcp(sock, IPPROTO_TCP, TCP_KEEPINTVL, CONFIG_HU_APP_TCP_KEEPINTVL, "TCP_KEEPINTVL");
+	_setsockopt_tcp(sock, IPPROTO_TCP, TCP_KEEPCNT, CONFIG_HU_APP_TCP_KEEPCNT, "TCP_KEEPCNT");
+#endif
+}
+
+static void _close_client(struct handle* h)
+{
+	if (h->client >= 0)
+	{
+		zsock_close(h->client);
+		h->client = -1;
+	}
+}
+
+static int _accept_tcp(struct handle* h)
+{
+	struct sockaddr_in addr;
+	socklen_t addr_sz = sizeof(addr);
+	char peer[INET_ADDRSTRLEN];
+
+	h->client = accept(h->sock, (struct sockaddr*)&addr, &addr_sz);
+	if (h->client < 0)
+	{
+		LOG_ERR("TCP: Failed to accept %d", errno);
+		return -errno;
+	}
+
+	_setup_client(h->client);
+	reset_hupacket(h->hup);
+
+	if (inet_ntop(AF_INET, &addr.sin_addr, peer, sizeof(peer)) != NULL)
+		LOG_INF("TCP: Connected %s:%d", peer, ntohs(addr.sin_port));
+	return 0;
+}
+
+static int _send_tcp(void* user_data, const uint8_t* buffer, size_t size)
+{
+	struct handle* h = (struct handle*)user_data;
+	size_t sent = 0;
+
+	if (h->client < 0)
+		return -ENOTCONN;
+
+	while (sent < size)
+	{
+		ssize_t ret = send(h->client, buffer + sent, size - sent, 0);
+		if (ret < 0)
+		{
+			LOG_ERR("TCP: Failed to send %d", errno);
+			return -errno;
+		}
+		sent += ret;
+	}
+	return sent;
+}
+
+static int _recv_tcp(void* user_data, uint8_t* buffer, size_t size)
+{
+	struct handle* h = (struct handle*)user_data;
+	ssize_t received;
+
+	while (1)
+	{
+		/* a failed accept (out of sockets or buffers) is not fatal to the server */
+		if (h->client < 0 && _accept_tcp(h) != 0)
+		{
+			k_msleep(ACCEPT_RETRY_MS);
+			continue;
+		}
+
+		received = recv(h->client, buffer, size, 0);
+		if (received > 0)
+			return received;
+
+		if (received < 0)
+			LOG_WRN("TCP: Connection error %d", errno);
+		else
+			LOG_INF("TCP: Disconnected");
+		_close_client(h);
+	}
+}
+
+static void* _session_tcp(void* user_data)
+{
+	struct handle* h = (struct handle*)user_data;
+	return h->hup;
+}
+
+static int _listen_tcp(struct handle* h, struct sockaddr *addr, socklen_t addrlen)
+{
+	int ret;
+
+	h->sock = zsock_socket(addr->sa_family, SOCK_STREAM, IPPROTO_TCP);
+	if (h->sock < 0)
+	{
+		LOG_ERR("Failed to create TCP socket (tcp): %d", errno);
+		return -errno;
+	}
+
+	ret = zsock_bind(h->sock, addr, addrlen);
+	if (ret < 0)
+	{
+		close(h->sock);
+		LOG_ERR("Failed to bind TCP socket (tcp): %d", errno);
+		return -errno;
+	}
+
+	ret = zsock_listen(h->sock, 1);
+	if (ret < 0)
+	{
+		close(h->sock);
+		LOG_ERR("Failed to listen TCP socket (tcp): %d", errno);
+		return -errno;
+	}
+
+	return 0;
+}
+
+static void* _init_tcp(void* port, void* arg2, void* arg3)
+{
+	struct handle* h;
+	struct sockaddr_in addr_in;
+
+	h = malloc(sizeof(struct handle));
+	if (h == NULL)
+	{
+		LOG_ERR("Not enough memory");
+		return NULL;
+	}
+	(void)memset(h, 0, sizeof(struct handle));
+	h->client = -1;
+
+	h->hup = init_hupacket(NULL, _send_tcp, h);
+	if (h->hup == NULL)
+	{
+		LOG_ERR("Not enough memory");
+		free(h);
+		return NULL;
+	}
+
+	(void)memset(&addr_in, 0, sizeof(addr_in));
+	addr_in.sin_family = AF_INET;
+	addr_in.sin_port = htons((int)port);
+	addr_in.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	if (_listen_tcp(h, (struct sockaddr *)&addr_in, (socklen_t)sizeof(addr_in)) != 0)
+	{
+		deinit_hupacket(h->hup);
+		free(h);
+		return NULL;
+	}
+
+	return h;
+}
+
+static void _deinit_tcp(void* user_data)
+{
+	struct handle* h = (struct handle*)user_data;
+
+	if (h->client >= 0)
+		zsock_shutdown(h->client, SHUT_RDWR);
+	_close_client(h);
+	if (h->sock >= 0)
+	{
+		zsock_shutdown(h->sock, SHUT_RDWR);
+		zsock_close(h->sock);
+	}
+	if (h->hup != NULL)
+		deinit_hupacket(h->hup);
+	free(h);
+}
+
+const struct app_api tcp_server =
+{
+	.init = _init_tcp,
+	.deinit = _deinit_tcp,
+	.recv = _recv_tcp,
+	.send = _send_tcp,
+	.session = _session_tcp
+};
+
+#else
+
+const struct app_api tcp_server =
+{
+	.init = NULL,
+	.deinit = NULL,
+	.recv = NULL,
+	.send = NULL,
+	.session = NULL
+};
+
+#endif
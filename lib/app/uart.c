@@ -5,13 +5,21 @@
  */
 
 #include <app/app_api.h>
+#include <hu/hupacket.h>
+#include <hu/hutrace.h>
+#include <hu/palloc.h>
 
+#include <zephyr/drivers/gpio.h>
 #include <zephyr/drivers/uart.h>
 #include <zephyr/sys/ring_buffer.h>
+#include <zephyr/shell/shell.h>
 #include <zephyr/logging/log.h>
 
+#include <errno.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 LOG_MODULE_REGISTER(app_uart, CONFIG_LOG_DEFAULT_LEVEL);
 
@@ -19,10 +27,41 @@ LOG_MODULE_REGISTER(app_uart, CONFIG_LOG_DEFAULT_LEVEL);
 
 #if DT_NODE_HAS_STATUS(HUP_UART, okay)
 
-#define RX_BUF_SIZE  		512
-#define TX_BUF_SIZE  		512
+#define HUP_UART_USER		DT_PATH(zephyr_user)
+#define HUP_RS485			DT_ALIAS(hup_rs485)
 
-#define UART_FIFO_SIZE		64
+/* last byte of a hupacket frame, never part of the ASCII85 payload */
+#define HUP_UART_EOT		0x04
+
+#if CONFIG_HU_APP_UART_PALLOC
+#define ring_alloc		palloc
+#define ring_free		pfree
+#else
+#define ring_alloc		malloc
+#define ring_free		free
+#endif
+
+#if CONFIG_UART_ASYNC_API
+/*
+ * The async transport hands its rx buffers and tx ring to the UART DMA.
+ * They come from a heap in the nocache section: with the data cache on,
+ * the STM32 driver rejects any other buffer with -EFAULT.
+ */
+BUILD_ASSERT(!IS_ENABLED(CONFIG_DCACHE) || IS_ENABLED(CONFIG_NOCACHE_MEMORY),
+	"the async hup-uart needs CONFIG_NOCACHE_MEMORY with the data cache on");
+K_HEAP_DEFINE_NOCACHE(dma_heap, CONFIG_HU_APP_UART_ASYNC_DMA_HEAP_SIZE);
+
+#define RX_DMA_SIZE		CONFIG_HU_APP_UART_ASYNC_RX_BUF_SIZE
+#endif
+
+struct stats
+{
+	uint32_t rx_bytes;
+	uint32_t rx_dropped;
+	uint32_t rx_peak;
+	uint32_t tx_peak;
+	uint32_t wakeups;
+};
 
 struct handle
 {
@@ -32,62 +71,206 @@ struct handle
 #if (defined(CONFIG_UART_INTERRUPT_DRIVEN) || defined(CONFIG_UART_ASYNC_API))
 	struct ring_buf tx_buffer;
 	struct ring_buf rx_buffer;
-	uint8_t tx_data[RX_BUF_SIZE];
-	uint8_t rx_data[TX_BUF_SIZE];
+	uint32_t wakeup_bytes;
+	atomic_t rx_eot;				// a frame end is queued, skip the batch wait
+	uint8_t* tx_data;
+	uint8_t* rx_data;
+	uint32_t rx_size;
+	uint32_t tx_size;
+	struct stats stats;
 #if CONFIG_UART_ASYNC_API
-	uint8_t fifo_buffer[2][UART_FIFO_SIZE];
-	uint8_t* fifo_next;
-	int bytes_send;
+	uint8_t* rx_dma[2];				// both in one dma_heap block
+	bool dma;						// the tx ring is in dma_heap too
+	uint8_t* rx_next;
+	atomic_t tx_busy;
+	uint32_t tx_len;
+#endif
 #endif
+#if CONFIG_HU_APP_UART_RS485
+	struct gpio_dt_spec de;
+	struct k_timer de_timer;		// polls the end of the last stop bit
+	struct k_spinlock de_lock;
+	uint32_t char_us;
+	void* hup;
 #endif
+	sys_snode_t node;
 };
 
+/* every running UART transport, for the stats commands */
+static sys_slist_t uarts = SYS_SLIST_STATIC_INIT(&uarts);
+static K_MUTEX_DEFINE(uarts_lock);
+
+#if CONFIG_HU_APP_UART_RS485
+/* an integer on both sides, hupacket takes the node address as its decimal string */
+#define RS485_ADDRESS		DT_PROP_OR(HUP_UART_USER, hup_rs485_address, CONFIG_HU_APP_UART_RS485_ADDRESS)
+
+/* driver enable of the transceiver, left alone without a de gpio */
+static inline void _de_set(struct handle* h, int value)
+{
+	if (h->de.port != NULL)
+		gpio_pin_set_dt(&h->de, value);
+}
+
+static inline bool _de_used(struct handle* h)
+{
+	return h->de.port != NULL;
+}
+
+/*
+ * The transmitter drains after the last byte left the fifo. Rather than
+ * spinning in the ISR on the transmission complete flag, poll it once per
+ * character time from a timer and release the bus then.
+ */
+static void _de_expiry(struct k_timer* timer)
+{
+	struct handle* h = CONTAINER_OF(timer, struct handle, de_timer);
+	k_spinlock_key_t key = k_spin_lock(&h->de_lock);
+
+	if (ring_buf_is_empty(&h->tx_buffer))
+	{
+		if (uart_irq_tx_complete(h->dev) > 0)
+			_de_set(h, 0);
+		else
+			k_timer_start(&h->de_timer, K_USEC(h->char_us), K_NO_WAIT);
+	}
+	k_spin_unlock(&h->de_lock, key);
+}
+
+/* called from the ISR once the tx ring is empty and the tx irq disabled */
+static inline void _de_release(struct handle* h)
+{
+	if (!_de_used(h))
+		return;
+	if (uart_irq_tx_complete(h->dev) > 0)
+		_de_set(h, 0);
+	else
+		k_timer_start(&h->de_timer, K_USEC(h->char_us), K_NO_WAIT);
+}
+
+/* bus driven before the tx irq runs, under the lock the release timer takes */
+static inline void _de_drive(struct handle* h)
+{
+	k_spinlock_key_t key = k_spin_lock(&h->de_lock);
+	_de_set(h, 1);
+	uart_irq_tx_enable(h->dev);
+	k_spin_unlock(&h->de_lock, key);
+}
+#else
+#define _de_set(h, value)
+#define _de_release(h)
+#define _de_drive(h)		uart_irq_tx_enable((h)->dev)
+#endif
+
+#if (defined(CONFIG_UART_INTERRUPT_DRIVEN) || defined(CONFIG_UART_ASYNC_API))
+static inline void _rx_peak(struct handle* h)
+{
+	uint32_t size = ring_buf_size_get(&h->rx_buffer);
+	if (size > h->stats.rx_peak)
+		h->stats.rx_peak = size;
+}
+
+static inline void _tx_peak(struct handle* h)
+{
+	uint32_t size = ring_buf_size_get(&h->tx_buffer);
+	if (size > h->stats.tx_peak)
+		h->stats.tx_peak = size;
+}
+#endif
+
 #if CONFIG_UART_ASYNC_API
-static int _tx_from_queue(const struct device* dev, struct handle* h)
+/* start a DMA transfer of the queued data, unless one is already running */
+static void _tx_from_queue(struct handle* h)
 {
 	uint8_t *data_ptr;
+	int err;
 
-	h->bytes_send = ring_buf_get_claim(&h->tx_buffer, &data_ptr, TX_BUF_SIZE);
-	if(h->bytes_send > 0)
-		h->bytes_send = uart_tx(dev, data_ptr, h->bytes_send, SYS_FOREVER_MS);
-	else
-		h->bytes_send = 0;
+	if (!atomic_cas(&h->tx_busy, 0, 1))
+		return;
+
+	h->tx_len = ring_buf_get_claim(&h->tx_buffer, &data_ptr, h->tx_size);
+	if (h->tx_len == 0)
+	{
+		atomic_clear(&h->tx_busy);
+		return;
+	}
+
+	err = uart_tx(h->dev, data_ptr, h->tx_len, SYS_FOREVER_US);
+	if (err != 0)
+	{
+		LOG_ERR("uart tx error: %d, %d bytes dropped", err, h->tx_len);
+		ring_buf_get_finish(&h->tx_buffer, h->tx_len);
+		h->tx_len = 0;
+		atomic_clear(&h->tx_busy);
+		k_sem_give(&h->tx_done);
+	}
+}
+
+static void _rx_enable(struct handle* h)
+{
+	int err;
 
-	return h->bytes_send;
+	h->rx_next = h->rx_dma[1];
+	err = uart_rx_enable(h->dev, h->rx_dma[0], RX_DMA_SIZE
+		, CONFIG_HU_APP_UART_ASYNC_RX_TIMEOUT_US);
+	if (err != 0)
+		LOG_ERR("uart rx enable error: %d", err);
 }
 
 void _async_cb(const struct device *dev, struct uart_event *evt, void *user_data)
 {
 	struct handle* h = (struct handle*)user_data;
+	uint32_t written;
+
 	switch (evt->type) {
 	case UART_TX_DONE:
-		LOG_DBG("tx done: %d", evt->data.tx.len);
-		ring_buf_get_finish(&h->tx_buffer, h->bytes_send);
-		if(_tx_from_queue(dev, h) == 0)
-			k_sem_give(&h->tx_done);
+	case UART_TX_ABORTED:
+		LOG_DBG("tx %s: %d", evt->type == UART_TX_DONE ? "done" : "aborted", evt->data.tx.len);
+		HUP_TRACE("hup_uart_tx", evt->data.tx.len, 0);
+		ring_buf_get_finish(&h->tx_buffer, h->tx_len);
+		h->tx_len = 0;
+		atomic_clear(&h->tx_busy);
+		k_sem_give(&h->tx_done);
+		if (!ring_buf_is_empty(&h->tx_buffer))
+			_tx_from_queue(h);
 		break;
 
 	case UART_RX_RDY:
+		/* called on idle line, a full buffer or the end of a buffer */
 		LOG_DBG("rx rdy:%d/%d", evt->data.rx.offset, evt->data.rx.len);
-		ring_buf_put(&h->rx_buffer, evt->data.rx.buf + evt->data.rx.offset, evt->data.rx.len);
-		if (evt->data.rx.len > 0)
+		written = ring_buf_put(&h->rx_buffer, evt->data.rx.buf + evt->data.rx.offset, evt->data.rx.len);
+		if (written < evt->data.rx.len)
+		{
+			h->stats.rx_dropped += evt->data.rx.len - written;
+			LOG_ERR("rx ring buffer full, %d bytes dropped", evt->data.rx.len - written);
+		}
+		HUP_TRACE("hup_uart_rx", written, ring_buf_size_get(&h->rx_buffer));
+		if (written > 0)
+		{
+			h->stats.rx_bytes += written;
+			_rx_peak(h);
 			k_sem_give(&h->rx_done);
+		}
 		break;
 
 	case UART_RX_BUF_REQUEST:
 		LOG_DBG("rx request");
-		uart_rx_buf_rsp(dev, h->fifo_next, UART_FIFO_SIZE);
+		uart_rx_buf_rsp(dev, h->rx_next, RX_DMA_SIZE);
 		break;
 
 	case UART_RX_BUF_RELEASED:
 		LOG_DBG("rx released");
-		h->fifo_next = evt->data.rx_buf.buf;
+		h->rx_next = evt->data.rx_buf.buf;
+		break;
+
+	case UART_RX_STOPPED:
+		LOG_ERR("rx stopped: %d", evt->data.rx_stop.reason);
 		break;
 
 	case UART_RX_DISABLED:
 		LOG_DBG("rx disabled");
+		_rx_enable(h);
 		break;
-	
+
 	default:
 		LOG_DBG("unknown: %d", evt->type);
 		break;
@@ -101,12 +284,12 @@ static int _send_async(void* user_data, const uint8_t* data_ptr, size_t data_len
 	{
 		uint32_t written_to_buf = ring_buf_put(&h->tx_buffer, data_ptr, data_len);
 		data_len -= written_to_buf;
-		
-		if(k_sem_take(&h->tx_done, K_NO_WAIT) == 0)
-			_tx_from_queue(h->dev, h);
+		_tx_peak(h);
+
+		_tx_from_queue(h);
 
 		if(data_len == 0) break;
-		k_msleep(7);
+		k_sem_take(&h->tx_done, K_FOREVER);
 		data_ptr += written_to_buf;
 	}
 	return data_len;
@@ -126,8 +309,19 @@ static void _irq_cb(const struct device *dev, void *user_data)
 		{
 			int err;
 			uint8_t* bytes;
-			int _claimed = ring_buf_put_claim(&h->rx_buffer, &bytes, RX_BUF_SIZE);
-			int rx_size = uart_fifo_read(dev, bytes, _claimed);
+			uint32_t queued = ring_buf_size_get(&h->rx_buffer);
+			int _claimed = ring_buf_put_claim(&h->rx_buffer, &bytes, h->rx_size);
+			int rx_size;
+			if (_claimed == 0)
+			{
+				/* ring is full, drain the fifo or the rx irq stays pending */
+				uint8_t discard[16];
+				rx_size = uart_fifo_read(dev, discard, sizeof(discard));
+				if (rx_size > 0)
+					h->stats.rx_dropped += rx_size;
+				continue;
+			}
+			rx_size = uart_fifo_read(dev, bytes, _claimed);
 			if (rx_size < 0)
 			{
 				LOG_ERR("uart fifo read error: %d", rx_size);
@@ -136,10 +330,22 @@ static void _irq_cb(const struct device *dev, void *user_data)
 			{
 				if (rx_size > 0)
 				{
+					/* wake the reader on the first bytes, a frame end and once a batch is complete */
+					bool eot = memchr(bytes, HUP_UART_EOT, rx_size) != NULL;
 					if ((err = ring_buf_put_finish(&h->rx_buffer, rx_size)) != 0)
+					{
 						LOG_ERR("error rx ring buffer put:%d", err);
+					}
 					else
-						k_sem_give(&h->rx_done);
+					{
+						HUP_TRACE("hup_uart_rx", rx_size, queued + rx_size);
+						h->stats.rx_bytes += rx_size;
+						_rx_peak(h);
+						if (eot)
+							atomic_set(&h->rx_eot, 1);
+						if (queued == 0 || eot || queued + rx_size >= h->wakeup_bytes)
+							k_sem_give(&h->rx_done);
+					}
 				}
 			}
 		}
@@ -147,22 +353,22 @@ static void _irq_cb(const struct device *dev, void *user_data)
 		if (uart_irq_tx_ready(dev))
 		{
 			uint8_t *data_ptr;
-			uint32_t _claimed = ring_buf_get_claim(&h->tx_buffer, &data_ptr, TX_BUF_SIZE);
+			uint32_t _claimed = ring_buf_get_claim(&h->tx_buffer, &data_ptr, h->tx_size);
 			if(_claimed > 0)
 			{
 				int sent = uart_fifo_fill(dev, data_ptr, _claimed);
 				if (sent > 0)
 				{
+					HUP_TRACE("hup_uart_tx", sent, 0);
 					ring_buf_get_finish(&h->tx_buffer, sent);
 					k_sem_give(&h->tx_done);
 				}
 			}
-			else
+			else if (ring_buf_is_empty(&h->tx_buffer))
 			{
-				if (ring_buf_is_empty(&h->tx_buffer))
-				{
-					uart_irq_tx_disable(dev);
-				}
+				/* with a transceiver, keep driving the bus until the last stop bit */
+				uart_irq_tx_disable(dev);
+				_de_release(h);
 			}
 		}
 	}
@@ -175,8 +381,9 @@ static int _send_int(void* user_data, const uint8_t* data_ptr, size_t data_len)
 	{
 		uint32_t written_to_buf = ring_buf_put(&h->tx_buffer, data_ptr, data_len);
 		data_len -= written_to_buf;
-		
-		uart_irq_tx_enable(h->dev);
+		_tx_peak(h);
+
+		_de_drive(h);
 		if(data_len == 0) break;
 		k_sem_take(&h->tx_done, K_FOREVER);
 		data_ptr += written_to_buf;
@@ -209,6 +416,90 @@ static int _recv_poll(void* user_data, uint8_t* buffer, size_t len)
 	return i;
 }
 
+static void _deinit_uart(void* user_data)
+{
+	struct handle* h = (struct handle*)user_data;
+
+	if (h == NULL)
+		return;
+	k_mutex_lock(&uarts_lock, K_FOREVER);
+	sys_slist_find_and_remove(&uarts, &h->node);
+	k_mutex_unlock(&uarts_lock);
+#if CONFIG_UART_ASYNC_API || CONFIG_UART_INTERRUPT_DRIVEN
+	ring_free(h->rx_data);
+#if CONFIG_UART_ASYNC_API
+	if (h->dma)
+	{
+		k_heap_free(&dma_heap, h->rx_dma[0]);
+		k_heap_free(&dma_heap, h->tx_data);
+	}
+	else
+#endif
+	{
+		ring_free(h->tx_data);
+	}
+#endif
+	free(h);
+}
+
+#if CONFIG_UART_ASYNC_API || CONFIG_UART_INTERRUPT_DRIVEN
+/*
+ * Ring sizes of the instance, the zephyr,user node overrides Kconfig with
+ * hup-uart-*-buf-size for the hup-uart alias and hup-rs485-*-buf-size for
+ * the hup-rs485 alias.
+ */
+static void _ring_sizes(struct handle* h)
+{
+	h->rx_size = DT_PROP_OR(HUP_UART_USER, hup_uart_rx_buf_size, CONFIG_HU_APP_UART_RX_BUF_SIZE);
+	h->tx_size = DT_PROP_OR(HUP_UART_USER, hup_uart_tx_buf_size, CONFIG_HU_APP_UART_TX_BUF_SIZE);
+#if DT_NODE_HAS_STATUS(HUP_RS485, okay)
+	if (h->dev == DEVICE_DT_GET(HUP_RS485))
+	{
+		h->rx_size = DT_PROP_OR(HUP_UART_USER, hup_rs485_rx_buf_size, CONFIG_HU_APP_UART_RX_BUF_SIZE);
+		h->tx_size = DT_PROP_OR(HUP_UART_USER, hup_rs485_tx_buf_size, CONFIG_HU_APP_UART_TX_BUF_SIZE);
+	}
+#endif
+}
+
+/*
+ * Rings of the interrupt driven and async transports, the polling one has
+ * none. With dma the tx ring and the rx buffers come from dma_heap.
+ */
+static int _init_rings(struct handle* h, bool dma)
+{
+	_ring_sizes(h);
+	h->rx_data = ring_alloc(h->rx_size);
+#if CONFIG_UART_ASYNC_API
+	h->dma = dma;
+	if (dma)
+	{
+		/* uart_tx() reads the tx ring by DMA */
+		h->tx_data = k_heap_alloc(&dma_heap, h->tx_size, K_NO_WAIT);
+		h->rx_dma[0] = k_heap_alloc(&dma_heap, 2 * RX_DMA_SIZE, K_NO_WAIT);
+		if (h->tx_data == NULL || h->rx_dma[0] == NULL)
+		{
+			LOG_ERR("dma_heap too small for %u bytes tx ring and 2 x %u bytes rx buffers"
+				, h->tx_size, RX_DMA_SIZE);
+			return -ENOMEM;
+		}
+		h->rx_dma[1] = h->rx_dma[0] + RX_DMA_SIZE;
+	}
+	else
+#endif
+	{
+		h->tx_data = ring_alloc(h->tx_size);
+	}
+	if (h->rx_data == NULL || h->tx_data == NULL)
+	{
+		LOG_ERR("Not enough memory for %u/%u bytes rx/tx ring", h->rx_size, h->tx_size);
+		return -ENOMEM;
+	}
+	ring_buf_init(&h->rx_buffer, h->rx_size, h->rx_data);
+	ring_buf_init(&h->tx_buffer, h->tx_size, h->tx_data);
+	return 0;
+}
+#endif
+
 static struct handle* _init_handle(const struct device *dev) {
 	struct handle* h;
 
@@ -218,7 +509,7 @@ static struct handle* _init_handle(const struct device *dev) {
 		return NULL;
 	}
 
-	h = malloc(sizeof(struct handle));
+	h = calloc(1, sizeof(struct handle));
 	if (h == NULL)
 	{
 		LOG_ERR("Not enough memory");
@@ -229,19 +520,12 @@ static struct handle* _init_handle(const struct device *dev) {
 	k_sem_init(&h->rx_done, 0, 1);
 	k_sem_init(&h->tx_done, 1, 1);
 
-#if CONFIG_UART_ASYNC_API || CONFIG_UART_INTERRUPT_DRIVEN
-	ring_buf_init(&h->rx_buffer, sizeof(h->rx_data), h->rx_data);
-	ring_buf_init(&h->tx_buffer, sizeof(h->tx_data), h->tx_data);
-#endif
+	k_mutex_lock(&uarts_lock, K_FOREVER);
+	sys_slist_append(&uarts, &h->node);
+	k_mutex_unlock(&uarts_lock);
 	return h;
 }
 
-static void _deinit_uart(void* h)
-{
-	if (h != NULL)
-		free(h);
-}
-
 #if CONFIG_UART_ASYNC_API || CONFIG_UART_INTERRUPT_DRIVEN
 static int _recv_async_int(void* user_data, uint8_t* buffer, size_t len)
 {
@@ -250,10 +534,44 @@ static int _recv_async_int(void* user_data, uint8_t* buffer, size_t len)
 	while (ret == 0)
 	{
 		k_sem_take(&h->rx_done, K_FOREVER);
+		h->stats.wakeups ++;
 		ret = ring_buf_get(&h->rx_buffer, buffer, len);
 	}
 	return ret;
 }
+
+/*
+ * Lend the hupacket server the next contiguous part of the rx ring. After the
+ * first bytes arrive, wait up to HU_APP_UART_RX_WAKEUP_TIMEOUT_US for a batch
+ * of wakeup_bytes so the parser runs once per batch instead of once per read.
+ * A frame end ends the wait early, a short command is parsed at once.
+ */
+static int _claim_async_int(void* user_data, uint8_t** data, size_t len)
+{
+	struct handle* h = (struct handle*)user_data;
+	uint32_t ret = ring_buf_get_claim(&h->rx_buffer, data, len);
+	while (ret == 0)
+	{
+		k_sem_take(&h->rx_done, K_FOREVER);
+		h->stats.wakeups ++;
+#if CONFIG_UART_INTERRUPT_DRIVEN
+		/* wakeup_bytes stays 0 for the async transport */
+		if (ring_buf_size_get(&h->rx_buffer) < h->wakeup_bytes && !atomic_clear(&h->rx_eot))
+			k_sem_take(&h->rx_done, K_USEC(CONFIG_HU_APP_UART_RX_WAKEUP_TIMEOUT_US));
+#endif
+		atomic_clear(&h->rx_eot);
+		ret = ring_buf_get_claim(&h->rx_buffer, data, len);
+	}
+	return ret;
+}
+
+static void _finish_async_int(void* user_data, size_t len)
+{
+	struct handle* h = (struct handle*)user_data;
+	int err = ring_buf_get_finish(&h->rx_buffer, len);
+	if (err != 0)
+		LOG_ERR("error rx ring buffer get:%d", err);
+}
 #endif
 
 
@@ -265,10 +583,16 @@ static void* _init_async(void* arg1, void* arg2, void* arg3)
 
 	if ((h = _init_handle(dev)) == NULL)
 		return NULL;
+	if (_init_rings(h, true) != 0)
+	{
+		_deinit_uart(h);
+		return NULL;
+	}
 
-	h->fifo_next = h->fifo_buffer[1];
+	atomic_clear(&h->tx_busy);
+	k_sem_reset(&h->tx_done);
 	uart_callback_set(dev, _async_cb, h);
-	uart_rx_enable(dev, h->fifo_buffer[0], UART_FIFO_SIZE, 3000);
+	_rx_enable(h);
 
 	return h;
 }
@@ -278,7 +602,9 @@ const struct app_api uart_async =
 	.init = _init_async,
 	.deinit = _deinit_uart,
 	.recv = _recv_async_int,
-	.send = _send_async
+	.send = _send_async,
+	.claim = _claim_async_int,
+	.finish = _finish_async_int
 };
 #endif
 
@@ -294,7 +620,13 @@ static void* _init_int(void* arg1, void* arg2, void* arg3)
 		LOG_ERR("Not enough memory");
 		return NULL;
 	}
+	if (_init_rings(h, false) != 0)
+	{
+		_deinit_uart(h);
+		return NULL;
+	}
 
+	h->wakeup_bytes = CONFIG_HU_APP_UART_RX_WAKEUP_BYTES;
 	uart_irq_callback_user_data_set(dev, _irq_cb, h);
 	uart_irq_rx_enable(dev);
 	k_sem_reset(&h->tx_done);
@@ -307,7 +639,93 @@ const struct app_api uart_interrupt =
 	.init = _init_int,
 	.deinit = _deinit_uart,
 	.recv = _recv_async_int,
-	.send = _send_int
+	.send = _send_int,
+	.claim = _claim_async_int,
+	.finish = _finish_async_int
+};
+#endif
+
+
+#if CONFIG_HU_APP_UART_RS485
+/* the transport owns a parser that only takes frames for its bus address */
+static void* _init_rs485(void* arg1, void* arg2, void* arg3)
+{
+	struct handle* h;
+	char address[HUP_ADDRESS_SIZE];
+	int err;
+
+	if ((h = _init_int(arg1, arg2, arg3)) == NULL)
+		return NULL;
+
+	h->de = (struct gpio_dt_spec)GPIO_DT_SPEC_GET_OR(HUP_UART_USER, hup_rs485_de_gpios, {0});
+	if (h->de.port != NULL)
+	{
+		struct uart_config cfg;
+		uint32_t baudrate = uart_config_get(h->dev, &cfg) == 0 ? cfg.baudrate : (uint32_t)arg2;
+
+		/* start, 8 data, parity and stop bits */
+		h->char_us = MAX(11 * USEC_PER_SEC / MAX(baudrate, 1), 1);
+		k_timer_init(&h->de_timer, _de_expiry, NULL);
+		if (!gpio_is_ready_dt(&h->de) ||
+			(err = gpio_pin_configure_dt(&h->de, GPIO_OUTPUT_INACTIVE)) != 0)
+		{
+			LOG_ERR("Cannot configure rs485 driver enable");
+			goto error_init_rs485;
+		}
+	}
+
+	h->hup = init_hupacket(NULL, _send_int, h);
+	if (h->hup == NULL)
+	{
+		LOG_ERR("Not enough memory");
+		goto error_init_rs485;
+	}
+	snprintf(address, sizeof(address), "%d", RS485_ADDRESS);
+	if ((err = hupacket_set_address(h->hup, address)) != 0)
+	{
+		LOG_ERR("Invalid rs485 address %d: %d", RS485_ADDRESS, err);
+		goto error_init_rs485;
+	}
+	LOG_INF("rs485 node %d on %s", RS485_ADDRESS, h->dev->name);
+	return h;
+
+error_init_rs485:
+	uart_irq_rx_disable(h->dev);
+	if (h->hup != NULL)
+		deinit_hupacket(h->hup);
+	_deinit_uart(h);
+	return NULL;
+}
+
+static void _deinit_rs485(void* user_data)
+{
+	struct handle* h = (struct handle*)user_data;
+
+	if (h == NULL)
+		return;
+	uart_irq_rx_disable(h->dev);
+	uart_irq_tx_disable(h->dev);
+	if (_de_used(h))
+		k_timer_stop(&h->de_timer);
+	_de_set(h, 0);
+	deinit_hupacket(h->hup);
+	_deinit_uart(h);
+}
+
+static void* _session_rs485(void* user_data)
+{
+	return ((struct handle*)user_data)->hup;
+}
+
+const struct app_api uart_rs485 =
+{
+	.init = _init_rs485,
+	.deinit = _deinit_rs485,
+	.recv = _recv_async_int,
+	.send = _send_int,
+	.session = _session_rs485,
+	.claim = _claim_async_int,
+	.finish = _finish_async_int
 };
 #endif
 
@@ -334,6 +752,86 @@ const struct app_api uart_polling =
 	.send = _send_poll
 };
 
+#if CONFIG_UART_ASYNC_API || CONFIG_UART_INTERRUPT_DRIVEN
+/* "name,rx size,rx peak,rx dropped,rx bytes,wakeups,tx size,tx peak" */
+static int _format_stats(struct handle* u, char* buffer, size_t size)
+{
+	return snprintf(buffer, size, "%s,%u,%u,%u,%u,%u,%u,%u", u->dev->name
+		, u->rx_size, u->stats.rx_peak, u->stats.rx_dropped, u->stats.rx_bytes
+		, u->stats.wakeups, u->tx_size, u->stats.tx_peak);
+}
+
+static void _reset_stats(void)
+{
+	struct handle* u;
+
+	k_mutex_lock(&uarts_lock, K_FOREVER);
+	SYS_SLIST_FOR_EACH_CONTAINER(&uarts, u, node)
+		memset(&u->stats, 0, sizeof(u->stats));
+	k_mutex_unlock(&uarts_lock);
+}
+
+#if CONFIG_HU_PACKET
+/* uart [reset]: one _format_stats record per UART transport */
+static void _uart_stats(void* h, int argc, const char** argv)
+{
+	struct handle* u;
+	char record[96];
+
+	hupacket_ack_response(h, NULL);
+	k_mutex_lock(&uarts_lock, K_FOREVER);
+	SYS_SLIST_FOR_EACH_CONTAINER(&uarts, u, node)
+	{
+		_format_stats(u, record, sizeof(record));
+		hupacket_record_str(h, NULL, record);
+	}
+	k_mutex_unlock(&uarts_lock);
+	hupacket_send_buffer(h, NULL);
+
+	if (argc > 1 && strcmp(argv[1], "reset") == 0)
+		_reset_stats();
+}
+DEFINE_HUP_CMD(hup_cmd_uart, "uart", _uart_stats);
+#endif
+
+#if CONFIG_SHELL
+static int _shell_stats(const struct shell* sh, size_t argc, char** argv)
+{
+	struct handle* u;
+
+	k_mutex_lock(&uarts_lock, K_FOREVER);
+	if (sys_slist_is_empty(&uarts))
+	{
+		k_mutex_unlock(&uarts_lock);
+		shell_error(sh, "no UART transport is running");
+		return -ENODEV;
+	}
+	SYS_SLIST_FOR_EACH_CONTAINER(&uarts, u, node)
+	{
+		shell_print(sh, "%s", u->dev->name);
+		shell_print(sh, "  rx ring  %u/%u peak, %u dropped, %u bytes, %u wakeups",
+			u->stats.rx_peak, u->rx_size, u->stats.rx_dropped, u->stats.rx_bytes, u->stats.wakeups);
+		shell_print(sh, "  tx ring  %u/%u peak", u->stats.tx_peak, u->tx_size);
+	}
+	k_mutex_unlock(&uarts_lock);
+	return 0;
+}
+
+static int _shell_reset(const struct shell* sh, size_t argc, char** argv)
+{
+	_reset_stats();
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_hup_uart,
+	SHELL_CMD(stats, NULL, "Show ring occupancy and overflow counters", _shell_stats),
+	SHELL_CMD(reset, NULL, "Clear the counters", _shell_reset),
+	SHELL_SUBCMD_SET_END
+);
+SHELL_CMD_REGISTER(hup_uart, &sub_hup_uart, "UART hupacket transports", NULL);
+#endif
+#endif
+
 #else
 #error "hup-uart device is disabled."
 #endif
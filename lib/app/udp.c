@@ -7,11 +7,16 @@
 
 #include <app/udp.h>
 #include <app/app_api.h>
+#include <hu/hupacket.h>
 
 #include <zephyr/kernel.h>
 #include <zephyr/net/socket.h>
+#include <zephyr/net/net_context.h>
+#include <zephyr/net/net_pkt.h>
+#include <zephyr/net/igmp.h>
 #include <zephyr/posix/sys/socket.h>
 #include <zephyr/posix/unistd.h>
+#include <zephyr/sys/hash_function.h>
 #include <zephyr/logging/log.h>
 
 #include <arpa/inet.h>
@@ -21,18 +26,73 @@
 #if CONFIG_NET_L2_ETHERNET
 LOG_MODULE_REGISTER(app_udp, CONFIG_LOG_DEFAULT_LEVEL);
 
+struct handle;
+
+/* hupacket parser state of one peer, looked up by its address and port */
+struct session
+{
+	struct handle* server;
+	struct sockaddr addr;
+	socklen_t addr_sz;
+	int64_t last_seen;
+	void* hup;
+	bool used;
+#if CONFIG_HU_APP_UDP_TX_COALESCE
+	size_t tx_len;
+	uint8_t tx[CONFIG_HU_PACKET_SIZE];
+#endif
+#if CONFIG_HU_APP_UDP_REPLAY
+	char sequence[12];				// of the last request
+	bool replay;					// reply holds the whole answer to it
+	bool capture;					// a request of this datagram is answered
+	size_t reply_len;
+	uint8_t reply[CONFIG_HU_PACKET_SIZE];
+#endif
+};
+
+#if CONFIG_HU_APP_UDP_NET_CONTEXT
+struct rx_item
+{
+	struct net_pkt* pkt;
+	struct sockaddr_in addr;
+};
+#endif
+
 struct handle
 {
-    int sock;
+	int sock;
 	struct sockaddr client;
 	socklen_t client_sz;
+
+	int batch;
+	struct session* current;
+	struct session sessions[CONFIG_HU_APP_UDP_SESSIONS];
+
+#if CONFIG_HU_APP_UDP_NET_CONTEXT
+	struct net_context* ctx;
+	struct net_pkt* pkt;
+	struct k_msgq rxq;
+	struct rx_item rxq_buffer[CONFIG_HU_APP_UDP_NET_CONTEXT_QUEUE];
+#endif
 };
 
-static ssize_t _send_udp(void* user_data, const uint8_t* buffer, size_t size)
+static ssize_t _sendto(struct handle* h, const uint8_t* buffer, size_t size
+	, const struct sockaddr* addr, socklen_t addr_sz)
 {
-	struct handle* h = (struct handle*)user_data;
-	ssize_t ret = sendto(h->sock, buffer, size, 0, &h->client, h->client_sz);
+	ssize_t ret;
+
+#if CONFIG_HU_APP_UDP_NET_CONTEXT
+	if (h->ctx != NULL)
+	{
+		ret = net_context_sendto(h->ctx, buffer, size, addr, addr_sz
+			, NULL, K_SECONDS(1), NULL);
+		if (ret < 0)
+			LOG_ERR("UDP: Failed to send %d", (int)ret);
+		return ret;
+	}
+#endif
 
+	ret = sendto(h->sock, buffer, size, 0, addr, addr_sz);
 	if (ret < 0)
 	{
 		LOG_ERR("UDP: Failed to send %d", errno);
@@ -41,23 +101,267 @@ static ssize_t _send_udp(void* user_data, const uint8_t* buffer, size_t size)
 	return ret;
 }
 
+static ssize_t _send_udp(void* user_data, const uint8_t* buffer, size_t size)
+{
+	struct handle* h = (struct handle*)user_data;
+	return _sendto(h, buffer, size, &h->client, h->client_sz);
+}
+
+#if CONFIG_HU_APP_UDP_TX_COALESCE
+static void _flush_session(struct session* s)
+{
+	if (s->tx_len > 0)
+	{
+		_sendto(s->server, s->tx, s->tx_len, &s->addr, s->addr_sz);
+		s->tx_len = 0;
+	}
+}
+#endif
+
+static void _flush_udp(struct handle* h)
+{
+#if CONFIG_HU_APP_UDP_TX_COALESCE
+	for (size_t i = 0; i < CONFIG_HU_APP_UDP_SESSIONS; i ++)
+		_flush_session(&h->sessions[i]);
+#endif
+}
+
+static ssize_t _queue_session(struct session* s, const uint8_t* buffer, size_t size)
+{
+#if CONFIG_HU_APP_UDP_TX_COALESCE
+	if (s->tx_len + size > sizeof(s->tx))
+		_flush_session(s);
+	if (size <= sizeof(s->tx))
+	{
+		memcpy(&s->tx[s->tx_len], buffer, size);
+		s->tx_len += size;
+		return size;
+	}
+#endif
+	return _sendto(s->server, buffer, size, &s->addr, s->addr_sz);
+}
+
+static ssize_t _send_session(void* user_data, const uint8_t* buffer, size_t size)
+{
+	struct session* s = (struct session*)user_data;
+#if CONFIG_HU_APP_UDP_REPLAY
+	/* a CRC NAK of this datagram is not kept, the request never ran */
+	if (s->capture && s->replay && s->reply_len + size <= sizeof(s->reply))
+	{
+		memcpy(&s->reply[s->reply_len], buffer, size);
+		s->reply_len += size;
+	}
+	else if (s->capture)
+	{
+		s->replay = false;
+	}
+#endif
+	return _queue_session(s, buffer, size);
+}
+
+#if CONFIG_HU_APP_UDP_REPLAY
+/*
+ * A host resends a request with the same sequence when the reply was lost.
+ * It gets the stored reply again, a flash write or any other command with
+ * side effects is not run twice. Requests without a sequence always run.
+ */
+static bool _filter_session(void* user_data, const char* cmd, const char* sequence)
+{
+	struct session* s = (struct session*)user_data;
+
+	if (sequence != NULL && s->replay && strcmp(sequence, s->sequence) == 0)
+	{
+		LOG_DBG("UDP: %s:%s retransmitted, %d bytes reply resent", cmd, sequence, (int)s->reply_len);
+		if (s->reply_len > 0)
+			_queue_session(s, s->reply, s->reply_len);
+		return true;
+	}
+
+	s->replay = sequence != NULL && strlen(sequence) < sizeof(s->sequence);
+	if (s->replay)
+		strcpy(s->sequence, sequence);
+	s->reply_len = 0;
+	s->capture = true;
+	return false;
+}
+#endif
+
+static uint32_t _peer_hash(const struct sockaddr* addr)
+{
+	const struct sockaddr_in* in = (const struct sockaddr_in*)addr;
+	uint32_t key[2] = { in->sin_addr.s_addr, in->sin_port };
+
+	return sys_hash32(key, sizeof(key));
+}
+
+static bool _same_peer(const struct sockaddr* a, const struct sockaddr* b)
+{
+	const struct sockaddr_in* ina = (const struct sockaddr_in*)a;
+	const struct sockaddr_in* inb = (const struct sockaddr_in*)b;
+
+	return ina->sin_family == inb->sin_family
+		&& ina->sin_port == inb->sin_port
+		&& ina->sin_addr.s_addr == inb->sin_addr.s_addr;
+}
+
+/* releases the parser of a peer that went quiet, its slot is free again */
+static void _free_session(struct session* s)
+{
+	char peer[INET_ADDRSTRLEN];
+
+#if CONFIG_HU_APP_UDP_TX_COALESCE
+	_flush_session(s);
+#endif
+	if (inet_ntop(AF_INET, &((struct sockaddr_in*)&s->addr)->sin_addr, peer, sizeof(peer)) != NULL)
+		LOG_INF("UDP: Peer %s:%d timed out", peer, ntohs(((struct sockaddr_in*)&s->addr)->sin_port));
+	deinit_hupacket(s->hup);
+	s->hup = NULL;
+	s->used = false;
+}
+
+static struct session* _find_session(struct handle* h)
+{
+	int64_t now = k_uptime_get();
+	size_t first = _peer_hash(&h->client) % CONFIG_HU_APP_UDP_SESSIONS;
+	struct session* victim = NULL;
+	char peer[INET_ADDRSTRLEN];
+
+	/* probe from the hashed slot, the table is small enough to scan it whole */
+	for (size_t i = 0; i < CONFIG_HU_APP_UDP_SESSIONS; i ++)
+	{
+		struct session* s = &h->sessions[(first + i) % CONFIG_HU_APP_UDP_SESSIONS];
+
+		if (s->used && now - s->last_seen > CONFIG_HU_APP_UDP_SESSION_TIMEOUT_MS)
+			_free_session(s);
+		if (s->used && _same_peer(&s->addr, &h->client))
+		{
+			s->last_seen = now;
+#if CONFIG_HU_APP_UDP_REPLAY
+			s->capture = false;
+#endif
+			return s;
+		}
+		if (victim == NULL || (victim->used && (!s->used || s->last_seen < victim->last_seen)))
+			victim = s;
+	}
+
+	if (victim->hup == NULL)
+	{
+		victim->hup = init_hupacket(NULL, _send_session, victim);
+		if (victim->hup == NULL)
+		{
+			LOG_ERR("UDP: Not enough memory for a peer session");
+			return NULL;
+		}
+#if CONFIG_HU_APP_UDP_REPLAY
+		hupacket_set_filter(victim->hup, _filter_session);
+#endif
+	}
+	else
+	{
+		reset_hupacket(victim->hup);
+	}
+#if CONFIG_HU_APP_UDP_TX_COALESCE
+	_flush_session(victim);
+#endif
+#if CONFIG_HU_APP_UDP_REPLAY
+	victim->replay = false;
+	victim->capture = false;
+	victim->reply_len = 0;
+#endif
+
+	victim->server = h;
+	victim->addr = h->client;
+	victim->addr_sz = h->client_sz;
+	victim->last_seen = now;
+	victim->used = true;
+	if (inet_ntop(AF_INET, &((struct sockaddr_in*)&victim->addr)->sin_addr, peer, sizeof(peer)) != NULL)
+		LOG_INF("UDP: New peer %s:%d", peer, ntohs(((struct sockaddr_in*)&victim->addr)->sin_port));
+	return victim;
+}
+
 static ssize_t _recv_udp(void* user_data, uint8_t* buffer, size_t size)
 {
-	ssize_t received;
+	ssize_t received = -EAGAIN;
 	struct handle* h = (struct handle*)user_data;
 
-	h->client_sz = sizeof(h->client);
-	received = recvfrom(h->sock, buffer, size, 0,
-		&h->client, &h->client_sz);
+	/* drain what is already queued without sleeping */
+	if (h->batch > 0 && h->batch < CONFIG_HU_APP_UDP_RX_BATCH)
+	{
+		h->client_sz = sizeof(h->client);
+		received = recvfrom(h->sock, buffer, size, MSG_DONTWAIT,
+			&h->client, &h->client_sz);
+		if (received < 0)
+			received = -errno;
+	}
+
+	if (received == -EAGAIN || received == -EWOULDBLOCK)
+	{
+		_flush_udp(h);
+		h->batch = 0;
+
+		h->client_sz = sizeof(h->client);
+		received = recvfrom(h->sock, buffer, size, 0,
+			&h->client, &h->client_sz);
+		if (received < 0)
+			received = -errno;
+	}
 
 	if (received < 0)
 	{
-		LOG_ERR("UDP: Failed to receive %d", errno);
-		received = -errno;
+		LOG_ERR("UDP: Failed to receive %d", (int)-received);
+		return received;
 	}
+
+	h->batch ++;
+	h->current = _find_session(h);
 	return received;
 }
 
+static void* _session_udp(void* user_data)
+{
+	struct handle* h = (struct handle*)user_data;
+	return h->current != NULL ? h->current->hup : NULL;
+}
+
+
+#if defined(CONFIG_HU_APP_UDP_MCAST_ADDR)
+/* join the group that multicast flash chunks are sent to, not fatal on error */
+static int _join_mcast(struct handle* h)
+{
+	struct in_addr group;
+	int ret;
+
+	if (CONFIG_HU_APP_UDP_MCAST_ADDR[0] == '\0')
+		return 0;
+	if (zsock_inet_pton(AF_INET, CONFIG_HU_APP_UDP_MCAST_ADDR, &group) != 1)
+	{
+		LOG_ERR("Invalid multicast group %s", CONFIG_HU_APP_UDP_MCAST_ADDR);
+		return -EINVAL;
+	}
+
+	if (h->sock >= 0)
+	{
+		struct ip_mreqn mreqn = { .imr_multiaddr = group, .imr_ifindex = 0 };
+
+		ret = zsock_setsockopt(h->sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreqn, sizeof(mreqn));
+		if (ret < 0)
+			ret = -errno;
+	}
+	else
+	{
+		ret = net_ipv4_igmp_join(net_if_get_default(), &group, NULL);
+	}
+
+	if (ret < 0 && ret != -EALREADY)
+		LOG_ERR("Failed to join multicast group %s: %d", CONFIG_HU_APP_UDP_MCAST_ADDR, ret);
+	else
+		LOG_INF("UDP joined multicast group %s", CONFIG_HU_APP_UDP_MCAST_ADDR);
+	return ret;
+}
+#else
+#define _join_mcast(h)	0
+#endif
 
 static int _bind_udp(struct handle* h, struct sockaddr *addr, socklen_t addrlen)
 {
@@ -92,6 +396,7 @@ static void* _init_udp(void* port, void* arg2, void* arg3)
 		LOG_ERR("Not enough memory");
 		return NULL;
 	}
+	(void)memset(h, 0, sizeof(struct handle));
 
 	(void)memset(&addr_in, 0, sizeof(addr_in));
 	addr_in.sin_family = AF_INET;
@@ -103,6 +408,7 @@ static void* _init_udp(void* port, void* arg2, void* arg3)
 		free(h);
 		return NULL;
 	}
+	(void)_join_mcast(h);
 
 	return h;
 }
@@ -115,6 +421,11 @@ static void _deinit_udp(void* user_data)
 		zsock_shutdown(h->sock, SHUT_RDWR);
 		zsock_close(h->sock);
 	}
+	for (size_t i = 0; i < CONFIG_HU_APP_UDP_SESSIONS; i ++)
+	{
+		if (h->sessions[i].hup != NULL)
+			deinit_hupacket(h->sessions[i].hup);
+	}
 	free(h);
 }
 
@@ -123,9 +434,193 @@ const struct app_api udp_server =
 	.init = _init_udp,
 	.deinit = _deinit_udp,
 	.recv = _recv_udp,
-	.send = _send_udp
+	.send = _send_udp,
+	.session = _session_udp
 };
 
+#if CONFIG_HU_APP_UDP_NET_CONTEXT
+static void _recv_cb(struct net_context* ctx, struct net_pkt* pkt
+	, union net_ip_header* ip_hdr, union net_proto_header* proto_hdr
+	, int status, void* user_data)
+{
+	struct handle* h = (struct handle*)user_data;
+	struct rx_item item;
+
+	if (pkt == NULL)
+		return;
+	if (status < 0 || ip_hdr == NULL || proto_hdr == NULL)
+	{
+		net_pkt_unref(pkt);
+		return;
+	}
+
+	/* the headers may not stay mapped, keep the peer address next to the packet */
+	(void)memset(&item, 0, sizeof(item));
+	item.pkt = pkt;
+	item.addr.sin_family = AF_INET;
+	item.addr.sin_port = proto_hdr->udp->src_port;
+	net_ipv4_addr_copy_raw((uint8_t*)&item.addr.sin_addr, ip_hdr->ipv4->src);
+
+	if (k_msgq_put(&h->rxq, &item, K_NO_WAIT) != 0)
+	{
+		LOG_WRN("UDP: Receive queue full, packet dropped");
+		net_pkt_unref(pkt);
+	}
+}
+
+static int _claim_udp_zc(void* user_data, uint8_t** data, size_t size)
+{
+	struct handle* h = (struct handle*)user_data;
+	struct net_pkt_cursor* cursor;
+	size_t len;
+
+	while (h->pkt == NULL)
+	{
+		struct rx_item item;
+
+		/* flush once the queue is empty or a batch was parsed, like the socket path */
+		if (h->batch >= CONFIG_HU_APP_UDP_RX_BATCH)
+		{
+			_flush_udp(h);
+			h->batch = 0;
+		}
+		if (k_msgq_get(&h->rxq, &item, K_NO_WAIT) != 0)
+		{
+			_flush_udp(h);
+			h->batch = 0;
+			k_msgq_get(&h->rxq, &item, K_FOREVER);
+		}
+		if (net_pkt_remaining_data(item.pkt) == 0)
+		{
+			net_pkt_unref(item.pkt);
+			continue;
+		}
+
+		h->pkt = item.pkt;
+		h->batch ++;
+		memcpy(&h->client, &item.addr, sizeof(item.addr));
+		h->client_sz = sizeof(item.addr);
+		h->current = _find_session(h);
+	}
+
+	/* hand out the rest of the fragment under the cursor */
+	cursor = &h->pkt->cursor;
+	while (cursor->pos == cursor->buf->data + cursor->buf->len && cursor->buf->frags != NULL)
+	{
+		cursor->buf = cursor->buf->frags;
+		cursor->pos = cursor->buf->data;
+	}
+	len = cursor->buf->len - (cursor->pos - cursor->buf->data);
+	len = MIN(len, net_pkt_remaining_data(h->pkt));
+
+	*data = cursor->pos;
+	return MIN(len, size);
+}
+
+static void _finish_udp_zc(void* user_data, size_t size)
+{
+	struct handle* h = (struct handle*)user_data;
+
+	if (h->pkt == NULL)
+		return;
+
+	if (size > 0)
+		net_pkt_skip(h->pkt, size);
+	if (net_pkt_remaining_data(h->pkt) == 0)
+	{
+		net_pkt_unref(h->pkt);
+		h->pkt = NULL;
+	}
+}
+
+static void* _init_udp_zc(void* port, void* arg2, void* arg3)
+{
+	struct handle* h;
+	struct sockaddr_in addr_in;
+	int ret;
+
+	h = malloc(sizeof(struct handle));
+	if (h == NULL)
+	{
+		LOG_ERR("Not enough memory");
+		return NULL;
+	}
+	(void)memset(h, 0, sizeof(struct handle));
+	h->sock = -1;
+	k_msgq_init(&h->rxq, (char*)h->rxq_buffer, sizeof(struct rx_item), ARRAY_SIZE(h->rxq_buffer));
+
+	(void)memset(&addr_in, 0, sizeof(addr_in));
+	addr_in.sin_family = AF_INET;
+	addr_in.sin_port = htons((int)port);
+	addr_in.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	ret = net_context_get(AF_INET, SOCK_DGRAM, IPPROTO_UDP, &h->ctx);
+	if (ret < 0)
+	{
+		LOG_ERR("Failed to get UDP context (udp): %d", ret);
+		goto error_init_udp_zc;
+	}
+
+	ret = net_context_bind(h->ctx, (struct sockaddr*)&addr_in, sizeof(addr_in));
+	if (ret < 0)
+	{
+		LOG_ERR("Failed to bind UDP context (udp): %d", ret);
+		goto error_init_udp_zc;
+	}
+
+	ret = net_context_recv(h->ctx, _recv_cb, K_NO_WAIT, h);
+	if (ret < 0)
+	{
+		LOG_ERR("Failed to receive on UDP context (udp): %d", ret);
+		goto error_init_udp_zc;
+	}
+	(void)_join_mcast(h);
+	return h;
+
+error_init_udp_zc:
+	if (h->ctx != NULL)
+		net_context_put(h->ctx);
+	free(h);
+	return NULL;
+}
+
+static void _deinit_udp_zc(void* user_data)
+{
+	struct handle* h = (struct handle*)user_data;
+	struct rx_item item;
+
+	net_context_put(h->ctx);
+	h->ctx = NULL;
+
+	while (k_msgq_get(&h->rxq, &item, K_NO_WAIT) == 0)
+		net_pkt_unref(item.pkt);
+	if (h->pkt != NULL)
+		net_pkt_unref(h->pkt);
+
+	_deinit_udp(h);
+}
+
+const struct app_api udp_zc_server =
+{
+	.init = _init_udp_zc,
+	.deinit = _deinit_udp_zc,
+	.recv = NULL,
+	.send = _send_udp,
+	.session = _session_udp,
+	.claim = _claim_udp_zc,
+	.finish = _finish_udp_zc
+};
+#else
+const struct app_api udp_zc_server =
+{
+	.init = NULL,
+	.deinit = NULL,
+	.recv = NULL,
+	.send = NULL,
+	.session = NULL
+};
+#endif
+
 #else
 
 const struct app_api udp_server =
@@ -133,7 +628,17 @@ const struct app_api udp_server =
 	.init = NULL,
 	.deinit = NULL,
 	.recv = NULL,
-	.send = NULL
+	.send = NULL,
+	.session = NULL
+};
+
+const struct app_api udp_zc_server =
+{
+	.init = NULL,
+	.deinit = NULL,
+	.recv = NULL,
+	.send = NULL,
+	.session = NULL
 };
 
 #endif
\ No newline at end of file
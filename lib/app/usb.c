@@ -7,7 +7,11 @@
 
 #include <sample_usbd.h>
 
+#include <app/app_api.h>
+#include <hu/hupacket.h>
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <zephyr/device.h>
 #include <zephyr/drivers/uart.h>
@@ -19,6 +23,32 @@
 
 LOG_MODULE_REGISTER(acm, LOG_LEVEL_INF);
 
+#if CONFIG_HU_APP_USB_ACM
+#define ACM_FS_MPS		64
+#define ACM_HS_MPS		512
+
+struct handle
+{
+	const struct device *dev;
+	struct k_sem tx_done;
+	struct k_sem rx_done;
+	struct ring_buf tx_buffer;
+	struct ring_buf rx_buffer;
+	struct k_spinlock tx_lock;		// the sender, the ISR and DTR clear use the tx ring
+	uint32_t mps;
+
+	/* throughput of the current DTR session */
+	int64_t start;
+	uint32_t rx_bytes;
+	uint32_t tx_bytes;
+
+	uint8_t tx_data[CONFIG_HU_APP_USB_ACM_BUF_SIZE];
+	uint8_t rx_data[CONFIG_HU_APP_USB_ACM_BUF_SIZE];
+};
+static struct handle* _acm;
+#endif
+static atomic_t dtr_set;
+
 static inline void print_baudrate(const struct device *dev)
 {
 	uint32_t baudrate;
@@ -34,6 +64,67 @@ static inline void print_baudrate(const struct device *dev)
 static struct usbd_context *sample_usbd;
 static K_SEM_DEFINE(dtr_sem, 0, 1);
 
+#if CONFIG_HU_APP_USB_ACM
+/* a DTR session starts, on DTR set or on init when the host was first */
+static void _acm_session(struct handle* h)
+{
+	h->mps = usbd_bus_speed(sample_usbd) == USBD_SPEED_HS ? ACM_HS_MPS : ACM_FS_MPS;
+	h->start = k_uptime_get();
+	h->rx_bytes = 0;
+	h->tx_bytes = 0;
+	LOG_INF("DTR set, %d bytes packets", h->mps);
+}
+#endif
+
+static void _acm_open(const struct device *dev)
+{
+	/* optional, they tell the host the line is up */
+	if (uart_line_ctrl_set(dev, UART_LINE_CTRL_DCD, 1) != 0 ||
+		uart_line_ctrl_set(dev, UART_LINE_CTRL_DSR, 1) != 0)
+		LOG_WRN("Failed to set DCD/DSR");
+
+#if CONFIG_HU_APP_USB_ACM
+	struct handle* h = _acm;
+
+	if (h == NULL || h->dev != dev)
+		return;
+
+	_acm_session(h);
+#endif
+}
+
+#if CONFIG_HU_APP_USB_ACM
+/* bytes per second of the current DTR session */
+static uint32_t _acm_rate(struct handle* h, int64_t* elapsed)
+{
+	*elapsed = k_uptime_get() - h->start;
+	return *elapsed > 0 ? (uint32_t)((uint64_t)(h->rx_bytes + h->tx_bytes) * 1000 / *elapsed) : 0;
+}
+
+#endif
+
+static void _acm_close(void)
+{
+#if CONFIG_HU_APP_USB_ACM
+	struct handle* h = _acm;
+	k_spinlock_key_t key;
+	int64_t elapsed;
+	uint32_t rate;
+
+	if (h == NULL)
+		return;
+
+	rate = _acm_rate(h, &elapsed);
+	LOG_INF("DTR clear, rx %u tx %u bytes in %lld ms, %u.%03u MB/s", h->rx_bytes, h->tx_bytes
+		, elapsed, rate / 1000000, (rate / 1000) % 1000);
+	/* drop what the host will not read anymore */
+	key = k_spin_lock(&h->tx_lock);
+	ring_buf_reset(&h->tx_buffer);
+	k_spin_unlock(&h->tx_lock, key);
+	k_sem_give(&h->tx_done);
+#endif
+}
+
 static void sample_msg_cb(struct usbd_context *const ctx, const struct usbd_msg *msg)
 {
 	LOG_DBG("USBD message: %s", usbd_msg_type_string(msg->type));
@@ -58,8 +149,15 @@ static void sample_msg_cb(struct usbd_context *const ctx, const struct usbd_msg
 		uint32_t dtr = 0U;
 
 		uart_line_ctrl_get(msg->dev, UART_LINE_CTRL_DTR, &dtr);
-		if (dtr)
+		if (dtr && !atomic_set(&dtr_set, 1))
+		{
+			_acm_open(msg->dev);
 			k_sem_give(&dtr_sem);
+		}
+		else if (!dtr && atomic_clear(&dtr_set))
+		{
+			_acm_close();
+		}
 	}
 
 	if (msg->type == USBD_MSG_CDC_ACM_LINE_CODING)
@@ -103,32 +201,225 @@ int init_app_usb(void)
 		return 0;
 	}
 
+	/* the transports wait for DTR themselves, no need to hold the boot */
 	ret = enable_usb_device_next();
 	if (ret != 0)
 	{
 		LOG_ERR("Failed to enable USB device support");
 		return 0;
 	}
-#if CONFIG_UART_LINE_CTRL_WAIT_DTR
-	LOG_INF("Wait for DTR");
-	k_sem_take(&dtr_sem, K_FOREVER);
-	LOG_INF("DTR set");
 
-	/* They are optional, we use them to test the interrupt endpoint */
-	ret = uart_line_ctrl_set(uart_dev, UART_LINE_CTRL_DCD, 1);
-	if (ret)
+	return 0;
+}
+
+#if CONFIG_HU_APP_USB_ACM
+static void _acm_irq_cb(const struct device *dev, void *user_data)
+{
+	struct handle* h = (struct handle*)user_data;
+
+	while (true)
+	{
+		uart_irq_update(dev);
+		if (uart_irq_is_pending(dev) <= 0)
+			break;
+		if (uart_irq_rx_ready(dev) > 0)
+		{
+			uint8_t* bytes;
+			uint32_t claimed = ring_buf_put_claim(&h->rx_buffer, &bytes, sizeof(h->rx_data));
+			int len;
+
+			if (claimed == 0)
+			{
+				/* the reader is behind, let usb flow control hold the host back */
+				uart_irq_rx_disable(dev);
+			}
+			else if ((len = uart_fifo_read(dev, bytes, claimed)) > 0)
+			{
+				ring_buf_put_finish(&h->rx_buffer, len);
+				h->rx_bytes += len;
+				k_sem_give(&h->rx_done);
+			}
+			else
+			{
+				ring_buf_put_finish(&h->rx_buffer, 0);
+			}
+		}
+
+		if (uart_irq_tx_ready(dev) > 0)
+		{
+			k_spinlock_key_t key = k_spin_lock(&h->tx_lock);
+			uint8_t* bytes;
+			uint32_t claimed = ring_buf_get_claim(&h->tx_buffer, &bytes, sizeof(h->tx_data));
+			int len;
+
+			/* whole packets while more is queued, the tail ends the transfer */
+			if (claimed > h->mps && ring_buf_size_get(&h->tx_buffer) > claimed)
+				claimed -= claimed % h->mps;
+			if (claimed == 0)
+			{
+				uart_irq_tx_disable(dev);
+				k_sem_give(&h->tx_done);
+			}
+			else
+			{
+				len = uart_fifo_fill(dev, bytes, claimed);
+				ring_buf_get_finish(&h->tx_buffer, len > 0 ? len : 0);
+				if (len > 0)
+				{
+					h->tx_bytes += len;
+					k_sem_give(&h->tx_done);
+				}
+			}
+			k_spin_unlock(&h->tx_lock, key);
+		}
+	}
+}
+
+static int _send_acm(void* user_data, const uint8_t* data_ptr, size_t data_len)
+{
+	struct handle* h = (struct handle*)user_data;
+	size_t len = data_len;
+
+	while (len > 0)
 	{
-		LOG_WRN("Failed to set DCD, ret code %d", ret);
+		k_spinlock_key_t key;
+		uint32_t written;
+
+		/* nobody reads, drop the response rather than block the server */
+		if (!atomic_get(&dtr_set))
+			return data_len;
+
+		key = k_spin_lock(&h->tx_lock);
+		written = ring_buf_put(&h->tx_buffer, data_ptr, len);
+		k_spin_unlock(&h->tx_lock, key);
+		data_ptr += written;
+		len -= written;
+		uart_irq_tx_enable(h->dev);
+		if (len > 0)
+			k_sem_take(&h->tx_done, K_FOREVER);
 	}
+	return data_len;
+}
 
-	ret = uart_line_ctrl_set(uart_dev, UART_LINE_CTRL_DSR, 1);
-	if (ret)
+static int _claim_acm(void* user_data, uint8_t** data, size_t len)
+{
+	struct handle* h = (struct handle*)user_data;
+	uint32_t ret;
+
+	while (!atomic_get(&dtr_set))
+		k_sem_take(&dtr_sem, K_FOREVER);
+
+	while ((ret = ring_buf_get_claim(&h->rx_buffer, data, len)) == 0)
+		k_sem_take(&h->rx_done, K_FOREVER);
+	return ret;
+}
+
+static void _finish_acm(void* user_data, size_t len)
+{
+	struct handle* h = (struct handle*)user_data;
+
+	ring_buf_get_finish(&h->rx_buffer, len);
+	uart_irq_rx_enable(h->dev);
+}
+
+static int _recv_acm(void* user_data, uint8_t* buffer, size_t len)
+{
+	uint8_t* data;
+	int ret = _claim_acm(user_data, &data, len);
+
+	memcpy(buffer, data, ret);
+	_finish_acm(user_data, ret);
+	return ret;
+}
+
+static void* _init_acm(void* arg1, void* arg2, void* arg3)
+{
+	struct handle* h;
+	const struct device* dev = (const struct device*)arg1;
+
+	if (dev == NULL || !device_is_ready(dev))
 	{
-		LOG_WRN("Failed to set DSR, ret code %d", ret);
+		LOG_ERR("CDC ACM device not ready");
+		return NULL;
 	}
-#endif
-	/* Wait 100ms for the host to do all settings */
-	k_msleep(500);
 
-	return 0;
+	h = calloc(1, sizeof(struct handle));
+	if (h == NULL)
+	{
+		LOG_ERR("Not enough memory");
+		return NULL;
+	}
+
+	h->dev = dev;
+	h->mps = ACM_FS_MPS;
+	k_sem_init(&h->rx_done, 0, 1);
+	k_sem_init(&h->tx_done, 0, 1);
+	ring_buf_init(&h->rx_buffer, sizeof(h->rx_data), h->rx_data);
+	ring_buf_init(&h->tx_buffer, sizeof(h->tx_data), h->tx_data);
+	_acm = h;
+	/* DTR raised before the transport existed found no handle */
+	if (atomic_get(&dtr_set))
+		_acm_session(h);
+
+	uart_irq_callback_user_data_set(dev, _acm_irq_cb, h);
+	uart_irq_rx_enable(dev);
+	return h;
+}
+
+static void _deinit_acm(void* user_data)
+{
+	struct handle* h = (struct handle*)user_data;
+
+	if (h == NULL)
+		return;
+	uart_irq_rx_disable(h->dev);
+	uart_irq_tx_disable(h->dev);
+	_acm = NULL;
+	free(h);
 }
+
+const struct app_api usb_acm =
+{
+	.init = _init_acm,
+	.deinit = _deinit_acm,
+	.recv = _recv_acm,
+	.send = _send_acm,
+	.claim = _claim_acm,
+	.finish = _finish_acm
+};
+
+#if CONFIG_HU_PACKET
+/* usb: packet size, rx bytes, tx bytes, ms since DTR, bytes per second */
+static void _usb_stats(void* hup, int argc, const char** argv)
+{
+	struct handle* h = _acm;
+	int64_t elapsed;
+	uint32_t rate;
+
+	if (h == NULL || !atomic_get(&dtr_set))
+	{
+		hupacket_nak_response(hup, NULL, -ENOTCONN);
+		hupacket_send_buffer(hup, NULL);
+		return;
+	}
+
+	rate = _acm_rate(h, &elapsed);
+	hupacket_ack_response(hup, NULL);
+	hupacket_record_int(hup, NULL, h->mps);
+	hupacket_record_int(hup, NULL, h->rx_bytes);
+	hupacket_record_int(hup, NULL, h->tx_bytes);
+	hupacket_record_int(hup, NULL, (int)elapsed);
+	hupacket_record_int(hup, NULL, rate);
+	hupacket_send_buffer(hup, NULL);
+}
+DEFINE_HUP_CMD(hup_cmd_usb, "usb", _usb_stats);
+#endif
+#else
+const struct app_api usb_acm =
+{
+	.init = NULL,
+	.deinit = NULL,
+	.recv = NULL,
+	.send = NULL
+};
+#endif
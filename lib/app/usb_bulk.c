@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <app/app_api.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/usb/usbd.h>
+#include <zephyr/usb/usb_ch9.h>
+#include <zephyr/drivers/usb/udc.h>
+#include <zephyr/logging/log.h>
+
+#include <errno.h>
+#include <string.h>
+
+#if CONFIG_HU_APP_USB_BULK
+LOG_MODULE_REGISTER(app_usb_bulk, CONFIG_LOG_DEFAULT_LEVEL);
+
+/*
+ * Vendor specific interface with one bulk OUT/IN pair, no class requests.
+ * Several OUT transfers are kept queued so the host can stream without
+ * waiting for the parser, IN transfers are pipelined the same way.
+ */
+#define BULK_FS_MPS		64
+#define BULK_HS_MPS		512
+
+struct bulk_desc
+{
+	struct usb_if_descriptor if0;
+	struct usb_ep_descriptor if0_out_ep;
+	struct usb_ep_descriptor if0_in_ep;
+	struct usb_ep_descriptor if0_hs_out_ep;
+	struct usb_ep_descriptor if0_hs_in_ep;
+	struct usb_desc_header nil_desc;
+};
+
+struct handle
+{
+	struct usbd_class_data* c_data;
+	atomic_t enabled;
+	/* completed OUT transfers, and the one the parser is reading */
+	struct k_fifo rx_fifo;
+	struct net_buf* rx_buf;
+	size_t rx_offset;
+	/* free IN transfer slots */
+	struct k_sem tx_slots;
+};
+
+#define BULK_EP_DESC(addr, mps) \
+{ \
+	.bLength = sizeof(struct usb_ep_descriptor), \
+	.bDescriptorType = USB_DESC_ENDPOINT, \
+	.bEndpointAddress = addr, \
+	.bmAttributes = USB_EP_TYPE_BULK, \
+	.wMaxPacketSize = sys_cpu_to_le16(mps), \
+	.bInterval = 0x00, \
+}
+
+static struct bulk_desc bulk_desc =
+{
+	.if0 = {
+		.bLength = sizeof(struct usb_if_descriptor),
+		.bDescriptorType = USB_DESC_INTERFACE,
+		.bInterfaceNumber = 0,
+		.bAlternateSetting = 0,
+		.bNumEndpoints = 2,
+		.bInterfaceClass = USB_BCC_VENDOR,
+		.bInterfaceSubClass = 0,
+		.bInterfaceProtocol = 0,
+		.iInterface = 0,
+	},
+	.if0_out_ep = BULK_EP_DESC(0x01, BULK_FS_MPS),
+	.if0_in_ep = BULK_EP_DESC(0x81, BULK_FS_MPS),
+	.if0_hs_out_ep = BULK_EP_DESC(0x01, BULK_HS_MPS),
+	.if0_hs_in_ep = BULK_EP_DESC(0x81, BULK_HS_MPS),
+	.nil_desc = {
+		.bLength = 0,
+		.bDescriptorType = 0,
+	},
+};
+
+static const struct usb_desc_header* bulk_fs_desc[] =
+{
+	(struct usb_desc_header*)&bulk_desc.if0,
+	(struct usb_desc_header*)&bulk_desc.if0_out_ep,
+	(struct usb_desc_header*)&bulk_desc.if0_in_ep,
+	(struct usb_desc_header*)&bulk_desc.nil_desc,
+};
+
+static const struct usb_desc_header* bulk_hs_desc[] =
+{
+	(struct usb_desc_header*)&bulk_desc.if0,
+	(struct usb_desc_header*)&bulk_desc.if0_hs_out_ep,
+	(struct usb_desc_header*)&bulk_desc.if0_hs_in_ep,
+	(struct usb_desc_header*)&bulk_desc.nil_desc,
+};
+
+static struct handle bulk_handle;
+
+static bool _is_hs(struct handle* h)
+{
+	return usbd_bus_speed(usbd_class_get_ctx(h->c_data)) == USBD_SPEED_HS;
+}
+
+static uint8_t _out_ep(struct handle* h)
+{
+	return _is_hs(h) ? bulk_desc.if0_hs_out_ep.bEndpointAddress : bulk_desc.if0_out_ep.bEndpointAddress;
+}
+
+static uint8_t _in_ep(struct handle* h)
+{
+	return _is_hs(h) ? bulk_desc.if0_hs_in_ep.bEndpointAddress : bulk_desc.if0_in_ep.bEndpointAddress;
+}
+
+static int _queue_out(struct handle* h)
+{
+	struct net_buf* buf;
+	int err;
+
+	buf = usbd_ep_buf_alloc(h->c_data, _out_ep(h), CONFIG_HU_APP_USB_BULK_BUF_SIZE);
+	if (buf == NULL)
+		return -ENOMEM;
+
+	err = usbd_ep_enqueue(h->c_data, buf);
+	if (err != 0)
+		usbd_ep_buf_free(usbd_class_get_ctx(h->c_data), buf);
+	return err;
+}
+
+static int _bulk_request(struct usbd_class_data* const c_data, struct net_buf* buf, int err)
+{
+	struct handle* h = usbd_class_get_private(c_data);
+	struct udc_buf_info* bi = udc_get_buf_info(buf);
+
+	if (bi->ep == _out_ep(h))
+	{
+		if (err == 0 && atomic_get(&h->enabled))
+		{
+			k_fifo_put(&h->rx_fifo, buf);
+			return 0;
+		}
+	}
+	else if (bi->ep == _in_ep(h))
+	{
+		k_sem_give(&h->tx_slots);
+	}
+
+	if (err != 0 && err != -ECONNABORTED)
+		LOG_ERR("ep 0x%02x request error %d", bi->ep, err);
+	return usbd_ep_buf_free(usbd_class_get_ctx(c_data), buf);
+}
+
+static void* _bulk_get_desc(struct usbd_class_data* const c_data, const enum usbd_speed speed)
+{
+	return speed == USBD_SPEED_HS ? (void*)bulk_hs_desc : (void*)bulk_fs_desc;
+}
+
+static void _bulk_enable(struct usbd_class_data* const c_data)
+{
+	struct handle* h = usbd_class_get_private(c_data);
+	int err;
+
+	atomic_set(&h->enabled, 1);
+	for (int i = 0; i < CONFIG_HU_APP_USB_BULK_OUT_TRANSFERS; i ++)
+	{
+		if ((err = _queue_out(h)) != 0)
+		{
+			LOG_ERR("Failed to queue OUT transfer %d: %d", i, err);
+			break;
+		}
+	}
+	LOG_INF("USB bulk enabled, %d bytes packets", _is_hs(h) ? BULK_HS_MPS : BULK_FS_MPS);
+}
+
+static void _bulk_disable(struct usbd_class_data* const c_data)
+{
+	struct handle* h = usbd_class_get_private(c_data);
+
+	/* the stack cancels the queued transfers, _bulk_request frees them */
+	atomic_clear(&h->enabled);
+	LOG_INF("USB bulk disabled");
+}
+
+static int _bulk_init(struct usbd_class_data* const c_data)
+{
+	struct handle* h = usbd_class_get_private(c_data);
+
+	h->c_data = c_data;
+	k_fifo_init(&h->rx_fifo);
+	k_sem_init(&h->tx_slots, CONFIG_HU_APP_USB_BULK_IN_TRANSFERS, CONFIG_HU_APP_USB_BULK_IN_TRANSFERS);
+	return 0;
+}
+
+static struct usbd_class_api bulk_api =
+{
+	.request = _bulk_request,
+	.enable = _bulk_enable,
+	.disable = _bulk_disable,
+	.init = _bulk_init,
+	.get_desc = _bulk_get_desc,
+};
+
+USBD_DEFINE_CLASS(hup_bulk, &bulk_api, &bulk_handle, NULL);
+
+static void _finish_bulk(void* user_data, size_t size);
+
+static int _claim_bulk(void* user_data, uint8_t** data, size_t size)
+{
+	struct handle* h = (struct handle*)user_data;
+
+	while (h->rx_buf == NULL)
+	{
+		h->rx_buf = k_fifo_get(&h->rx_fifo, K_FOREVER);
+		h->rx_offset = 0;
+		/* a zero length packet only ends a transfer */
+		if (h->rx_buf != NULL && h->rx_buf->len == 0)
+			_finish_bulk(h, 0);
+	}
+
+	*data = h->rx_buf->data + h->rx_offset;
+	return MIN(size, h->rx_buf->len - h->rx_offset);
+}
+
+static void _finish_bulk(void* user_data, size_t size)
+{
+	struct handle* h = (struct handle*)user_data;
+	int err;
+
+	if (h->rx_buf == NULL)
+		return;
+
+	h->rx_offset += size;
+	if (h->rx_offset < h->rx_buf->len)
+		return;
+
+	/* transfer consumed, give the endpoint a fresh one */
+	usbd_ep_buf_free(usbd_class_get_ctx(h->c_data), h->rx_buf);
+	h->rx_buf = NULL;
+	if (atomic_get(&h->enabled) && (err = _queue_out(h)) != 0)
+		LOG_ERR("Failed to queue OUT transfer: %d", err);
+}
+
+static int _recv_bulk(void* user_data, uint8_t* buffer, size_t size)
+{
+	uint8_t* data;
+	int ret = _claim_bulk(user_data, &data, size);
+
+	memcpy(buffer, data, ret);
+	_finish_bulk(user_data, ret);
+	return ret;
+}
+
+static int _send_bulk(void* user_data, const uint8_t* data_ptr, size_t data_len)
+{
+	struct handle* h = (struct handle*)user_data;
+	uint16_t mps = _is_hs(h) ? BULK_HS_MPS : BULK_FS_MPS;
+	size_t len = data_len;
+
+	while (len > 0)
+	{
+		size_t chunk = MIN(len, CONFIG_HU_APP_USB_BULK_BUF_SIZE);
+		struct net_buf* buf;
+		int err;
+
+		/* nobody reads, drop the response rather than block the server */
+		if (!atomic_get(&h->enabled))
+			return data_len;
+
+		k_sem_take(&h->tx_slots, K_FOREVER);
+		buf = usbd_ep_buf_alloc(h->c_data, _in_ep(h), chunk);
+		if (buf == NULL)
+		{
+			k_sem_give(&h->tx_slots);
+			LOG_ERR("Failed to allocate IN transfer");
+			return -ENOMEM;
+		}
+
+		net_buf_add_mem(buf, data_ptr, chunk);
+		data_ptr += chunk;
+		len -= chunk;
+		/* the host read ends on a short packet, terminate a full one */
+		if (len == 0 && (chunk % mps) == 0)
+			udc_ep_buf_set_zlp(buf);
+
+		err = usbd_ep_enqueue(h->c_data, buf);
+		if (err != 0)
+		{
+			usbd_ep_buf_free(usbd_class_get_ctx(h->c_data), buf);
+			k_sem_give(&h->tx_slots);
+			LOG_ERR("Failed to queue IN transfer: %d", err);
+			return err;
+		}
+	}
+	return data_len;
+}
+
+static void* _init_bulk(void* arg1, void* arg2, void* arg3)
+{
+	if (bulk_handle.c_data == NULL)
+	{
+		LOG_ERR("USB bulk class is not registered");
+		return NULL;
+	}
+	return &bulk_handle;
+}
+
+static void _deinit_bulk(void* user_data)
+{
+}
+
+const struct app_api usb_bulk =
+{
+	.init = _init_bulk,
+	.deinit = _deinit_bulk,
+	.recv = _recv_bulk,
+	.send = _send_bulk,
+	.claim = _claim_bulk,
+	.finish = _finish_bulk
+};
+#else
+const struct app_api usb_bulk =
+{
+	.init = NULL,
+	.deinit = NULL,
+	.recv = NULL,
+	.send = NULL
+};
+#endif
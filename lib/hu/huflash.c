@@ -12,12 +12,12 @@
 #include <hu/hupacket.h>
 #include <hu/ascii85.h>
 #include <hu/bootloader.h>
+#include <hu/palloc.h>
 #include <huerrno.h>
 
 LOG_MODULE_REGISTER(huflash, CONFIG_LOG_DEFAULT_LEVEL);
 
 #define ASCII85_ERROR_CODE_START    255
-#define ASCII85_MAX_CHUNK_SIZE      256
 
 enum {
     ARG_FLASH_CMD,
@@ -31,6 +31,68 @@ enum {
     ARG_FLASH_MAX
 };
 
+enum {
+    ARG_MBEGIN_CMD,
+    ARG_MBEGIN_PARTITION,
+    ARG_MBEGIN_SIZE,
+    ARG_MBEGIN_CHUNK,
+    ARG_MBEGIN_MAX
+};
+
+enum {
+    ARG_MFLASH_CMD,
+    ARG_MFLASH_OFFSET,
+    ARG_MFLASH_LENGTH,
+    ARG_MFLASH_ASCII85_DATA,
+    ARG_MFLASH_MAX
+};
+
+#if CONFIG_HU_PACKET_MULTICAST_FLASH
+/*
+ * Multicast flash: mbegin opens a session for an image of size bytes sent in
+ * chunk sized pieces. mflash chunks are sent to every device at once (UDP
+ * group or RS485 broadcast id) and are never answered, each device marks the
+ * chunks it wrote. mstatus lists the missing chunks, which the host repairs
+ * with unicast flash commands, and mend closes the session.
+ */
+/*
+ * The mflash frame around the ASCII85 data: markers, id, command, sequence,
+ * offset, length and crc. A chunk encodes to 5/4 of its size and the whole
+ * frame has to fit the receive buffer.
+ */
+#define MFLASH_FRAME_OVERHEAD       64
+#define MFLASH_MAX_CHUNK            ((RECV_BUFFER_SIZE - MFLASH_FRAME_OVERHEAD) / 5 * 4)
+BUILD_ASSERT(MFLASH_MAX_CHUNK > 0, "CONFIG_HU_PACKET_SIZE too small for mflash");
+
+struct mflash
+{
+    const struct flash_area* fa;
+    atomic_t* written;
+    uint32_t size;
+    uint32_t chunk;
+    uint32_t chunks;
+};
+static struct mflash mflash;
+static K_MUTEX_DEFINE(mflash_lock);
+
+static void _mflash_close(void)
+{
+    if (mflash.fa != NULL)
+        flash_area_close(mflash.fa);
+    pfree(mflash.written);
+    memset(&mflash, 0, sizeof(mflash));
+}
+
+static void _mflash_mark(const struct flash_area* fa, uint32_t offset, uint32_t size)
+{
+    k_mutex_lock(&mflash_lock, K_FOREVER);
+    if (mflash.fa != NULL && mflash.fa->fa_id == fa->fa_id && (offset % mflash.chunk) == 0
+        && offset < mflash.size && size == MIN(mflash.chunk, mflash.size - offset))
+        atomic_set_bit(mflash.written, offset / mflash.chunk);
+    k_mutex_unlock(&mflash_lock);
+}
+#endif
+
 
 struct fixed_partition
 {
@@ -85,7 +147,7 @@ static int open_flash_partition(const char* partition_name, const struct flash_a
     rc = get_partition_id(partition_name);
 #endif
 
-    if (rc != 0)
+    if (rc < 0)
         return rc;
     return flash_area_open(rc, fa);
 }
@@ -175,6 +237,7 @@ DEFINE_HUP_CMD(hup_cmd_erase, "erase", _erase);
 
 static void _flash(void* h, int argc, const char** argv)
 {
+    struct hup_handle* handle = (struct hup_handle*)h;
     int size;
     const struct flash_area* fa = NULL;
     int rc = -EINVAL;
@@ -186,18 +249,18 @@ static void _flash(void* h, int argc, const char** argv)
     if (rc != 0)
         goto fw_flash_error;
 
+    /* any size the decode buffer holds, mflash repairs send short last chunks */
     size = strtol(argv[ARG_FLASH_LENGTH], NULL, 16);
-    if (size <= ASCII85_MAX_CHUNK_SIZE)
+    if (size <= 0 || size > sizeof(handle->tx_buffer))
     {
         rc = -EINVAL;
     }
     else
     {
-        struct hup_handle* handle = (struct hup_handle*)h;
         int offset = strtol(argv[ARG_FLASH_OFFSET], NULL, 16);
         uint8_t* ptr = (uint8_t*)argv[ARG_FLASH_ASCII85_DATA];
         int32_t len = strlen(ptr);
-        int bin_len = decode_ascii85(ptr, len, handle->tx_buffer, (ASCII85_MAX_CHUNK_SIZE * 5));
+        int bin_len = decode_ascii85(ptr, len, handle->tx_buffer, sizeof(handle->tx_buffer));
 
         if (bin_len < 0)
             rc = -(bin_len + ASCII85_ERROR_CODE_START + EASCII85);
@@ -219,6 +282,10 @@ static void _flash(void* h, int argc, const char** argv)
                 last_size = size;
                 LOG_INF("Flash: Succeed offset 0x%08x, len 0x%x", offset, size);
             }
+#if CONFIG_HU_PACKET_MULTICAST_FLASH
+            if (rc == 0)
+                _mflash_mark(fa, offset, size);
+#endif
         }
     }
 
@@ -229,3 +296,159 @@ fw_flash_error:
     _set_done(h, argc, argv, ARG_FLASH_PARTITION, ARG_FLASH_LENGTH);
 }
 DEFINE_HUP_CMD(hup_cmd_flash, "flash", _flash);
+
+#if CONFIG_HU_PACKET_MULTICAST_FLASH
+/* mbegin partition size chunk: ack, number of chunks, partition */
+static void _mbegin(void* h, int argc, const char** argv)
+{
+    const struct flash_area* fa = NULL;
+    uint32_t size, chunk;
+    int rc = -EINVAL;
+
+    k_mutex_lock(&mflash_lock, K_FOREVER);
+    _mflash_close();
+    if (argc < ARG_MBEGIN_MAX)
+        goto fw_mbegin_error;
+
+    size = strtoul(argv[ARG_MBEGIN_SIZE], NULL, 16);
+    chunk = strtoul(argv[ARG_MBEGIN_CHUNK], NULL, 16);
+    if (chunk == 0 || size == 0)
+        goto fw_mbegin_error;
+    if (chunk > MFLASH_MAX_CHUNK)
+    {
+        LOG_INF("Mflash: chunk 0x%x over 0x%x", chunk, MFLASH_MAX_CHUNK);
+        rc = -EMSGSIZE;
+        goto fw_mbegin_error;
+    }
+
+    rc = open_flash_partition(argv[ARG_MBEGIN_PARTITION], &fa);
+    if (rc != 0)
+        goto fw_mbegin_error;
+    if (size > fa->fa_size)
+    {
+        rc = -EFBIG;
+        goto fw_mbegin_error;
+    }
+
+    mflash.chunks = DIV_ROUND_UP(size, chunk);
+    mflash.written = pcalloc(ATOMIC_BITMAP_SIZE(mflash.chunks), sizeof(atomic_t));
+    if (mflash.written == NULL)
+    {
+        rc = -ENOMEM;
+        goto fw_mbegin_error;
+    }
+    mflash.fa = fa;
+    mflash.size = size;
+    mflash.chunk = chunk;
+    fa = NULL;
+    LOG_INF("Mflash: begin partition %s, size 0x%x, %d chunks", argv[ARG_MBEGIN_PARTITION], size, mflash.chunks);
+
+fw_mbegin_error:
+    if (rc != 0)
+        mflash.chunks = 0;
+    _set_status(h, rc);
+    hupacket_record_int(h, NULL, mflash.chunks);
+    k_mutex_unlock(&mflash_lock);
+
+    close_flash_partition(fa);
+    _set_done(h, argc, argv, ARG_MBEGIN_PARTITION, ARG_MBEGIN_PARTITION);
+}
+DEFINE_HUP_CMD(hup_cmd_mbegin, "mbegin", _mbegin);
+
+/* never answered, the host asks for the missing chunks with mstatus */
+static void _mflash(void* h, int argc, const char** argv)
+{
+    struct hup_handle* handle = (struct hup_handle*)h;
+    uint32_t offset, size, index;
+    int bin_len;
+    int rc;
+
+    if (argc < ARG_MFLASH_MAX)
+        return;
+
+    offset = strtoul(argv[ARG_MFLASH_OFFSET], NULL, 16);
+    size = strtoul(argv[ARG_MFLASH_LENGTH], NULL, 16);
+
+    k_mutex_lock(&mflash_lock, K_FOREVER);
+    if (mflash.fa == NULL || (offset % mflash.chunk) != 0 || offset >= mflash.size
+        || size != MIN(mflash.chunk, mflash.size - offset))
+    {
+        LOG_DBG("Mflash: ignore offset 0x%08x, len 0x%x", offset, size);
+        goto fw_mflash_done;
+    }
+
+    index = offset / mflash.chunk;
+    if (atomic_test_bit(mflash.written, index))
+        goto fw_mflash_done;
+
+    bin_len = decode_ascii85((uint8_t*)argv[ARG_MFLASH_ASCII85_DATA], strlen(argv[ARG_MFLASH_ASCII85_DATA])
+        , handle->tx_buffer, sizeof(handle->tx_buffer));
+    if (bin_len != (int)size)
+    {
+        LOG_INF("Mflash: Failed decode offset 0x%08x, code %d", offset, bin_len);
+        goto fw_mflash_done;
+    }
+
+    rc = flash_area_write(mflash.fa, offset, handle->tx_buffer, size);
+    if (rc != 0)
+        LOG_INF("Mflash: Failed write offset 0x%08x, error code %d", offset, rc);
+    else
+        atomic_set_bit(mflash.written, index);
+
+fw_mflash_done:
+    k_mutex_unlock(&mflash_lock);
+}
+DEFINE_HUP_CMD(hup_cmd_mflash, "mflash", _mflash);
+
+/* ack, written chunks, total chunks, then missing chunk ranges "first-last" */
+static void _mstatus(void* h, int argc, const char** argv)
+{
+    struct hup_handle* handle = (struct hup_handle*)h;
+    /* room left for a range record, the crc and the end of packet */
+    const size_t limit = sizeof(handle->tx_buffer) - 32;
+    uint32_t written = 0;
+
+    k_mutex_lock(&mflash_lock, K_FOREVER);
+    if (mflash.fa == NULL)
+    {
+        k_mutex_unlock(&mflash_lock);
+        _set_status(h, -ENOENT);
+        hupacket_send_buffer(h, NULL);
+        return;
+    }
+
+    for (uint32_t i = 0; i < mflash.chunks; i ++)
+        written += atomic_test_bit(mflash.written, i);
+
+    _set_status(h, 0);
+    hupacket_record_int(h, NULL, written);
+    hupacket_record_int(h, NULL, mflash.chunks);
+    for (uint32_t i = 0; i < mflash.chunks && strlen(handle->tx_buffer) < limit; i ++)
+    {
+        uint32_t first = i;
+
+        if (atomic_test_bit(mflash.written, i))
+            continue;
+        while (i + 1 < mflash.chunks && !atomic_test_bit(mflash.written, i + 1))
+            i ++;
+        hupacket_record_hex(h, NULL, first);
+        hupacket_append_char(h, NULL, '-');
+        hupacket_append_hex(h, NULL, i);
+    }
+    k_mutex_unlock(&mflash_lock);
+
+    hupacket_send_buffer(h, NULL);
+}
+DEFINE_HUP_CMD(hup_cmd_mstatus, "mstatus", _mstatus);
+
+static void _mend(void* h, int argc, const char** argv)
+{
+    k_mutex_lock(&mflash_lock, K_FOREVER);
+    _set_status(h, mflash.fa != NULL ? 0 : -ENOENT);
+    _mflash_close();
+    k_mutex_unlock(&mflash_lock);
+
+    hupacket_send_buffer(h, NULL);
+}
+DEFINE_HUP_CMD(hup_cmd_mend, "mend", _mend);
+#endif
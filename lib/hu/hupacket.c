@@ -13,7 +13,9 @@
  *       write flash: partition=slot0, offset=0x10000, size=256
  *          size: binary size !!) NOT ascii85 encoded data size
  *       CRC16: for usart
- *       19: id for rs485
+ *       19: id for rs485, a node drops frames for other ids before buffering
+ *           them. Frames for the broadcast id reach every node, which answer
+ *           with their own id in their own time slot after the frame.
  *       21345: sequence for udp(optional)
  *
  *  !!) The packet length must be smaller than DATA_BUFFER_SIZE.
@@ -30,12 +32,14 @@
  */
 
 #include <hu/hupacket.h>
+#include <hu/hutrace.h>
 #include <hu/palloc.h>
 
 #include <zephyr/sys/crc.h>
 #include <zephyr/kernel.h>
 #include <zephyr/sys/crc.h>
 #include <zephyr/sys/iterable_sections.h>
+#include <zephyr/shell/shell.h>
 
 #include <zephyr/logging/log.h>
 
@@ -65,6 +69,41 @@ LOG_MODULE_REGISTER(hup, CONFIG_LOG_DEFAULT_LEVEL);
 #define SEED_CRC16	0x0000
 
 
+#if CONFIG_HU_PACKET_RS485
+#define BROADCAST_ID	CONFIG_HU_PACKET_RS485_BROADCAST_ID
+
+int hupacket_set_address(void* handle, const char* address)
+{
+	struct hup_handle* h = handle;
+	size_t len = address != NULL ? strlen(address) : 0;
+
+	if (len >= sizeof(h->address))
+		return -EINVAL;
+	memcpy(h->address, address, len);
+	h->address[len] = '\0';
+	h->slot = strtoul(h->address, NULL, 10);
+	return 0;
+}
+
+static bool match_id(struct hup_handle* h, const char* id)
+{
+	return strlen(id) == (size_t)h->state && memcmp(h->buffer, id, h->state) == 0;
+}
+
+/* returns false when the frame is not for this node */
+static bool filter_id(struct hup_handle* h, uint8_t ch)
+{
+	if (ch == ID_MARK)
+	{
+		h->id_pending = false;
+		h->broadcast = match_id(h, BROADCAST_ID);
+		return h->broadcast || match_id(h, h->address);
+	}
+	/* ids are short and printable, anything else means the frame has none */
+	return h->state < HUP_ADDRESS_SIZE && ch >= ' ' && ch != SEQUENCE_MARK;
+}
+#endif
+
 void* init_hupacket(void* h, send_func send, void* user_data)
 {
 	struct hup_handle* hup = (struct hup_handle*)h;
@@ -76,6 +115,7 @@ void* init_hupacket(void* h, send_func send, void* user_data)
 		reset_hupacket(hup);
 		hup->user_data = user_data;
 		hup->send = send;
+		hup->stats = &hup->own_stats;
 	}
 	return hup;
 }
@@ -86,6 +126,20 @@ void deinit_hupacket(void* h)
 		pfree(h);
 }
 
+/* count into a block shared by several handles, NULL for the handle's own */
+void hupacket_set_stats(void* handle, struct hup_stats* stats)
+{
+	struct hup_handle* h = handle;
+	h->stats = stats != NULL ? stats : &h->own_stats;
+}
+
+/* called with the user data of the handle before a command is run */
+void hupacket_set_filter(void* handle, filter_func filter)
+{
+	struct hup_handle* h = handle;
+	h->filter = filter;
+}
+
 static void seperate_header(struct hup_handle* h, char** ptr, char** dst, char ch)
 {
 	char* tmp;
@@ -108,6 +162,7 @@ static void process_data(struct hup_handle* h)
 		h->crc_match = crc_calculated == crc_received;
 		if (!h->crc_match)
 		{
+			h->stats->crc_errors ++;
 			if (!h->response)
 			{
 				hupacket_nak_response(h, h->tx_buffer, -ENMCRC16);
@@ -123,6 +178,13 @@ static void process_data(struct hup_handle* h)
 	seperate_header(h, &h->id, &h->argv[0], ID_MARK);
 	seperate_header(h, &h->argv[0], &h->sequence, SEQUENCE_MARK);
 
+	if (!h->response && h->filter != NULL
+		&& h->filter(h->user_data, h->argv[0], h->sequence))
+	{
+		reset_hupacket(h);
+		return;
+	}
+
 	if (h->response) {
 		STRUCT_SECTION_FOREACH(hup_resp, cmd)
 		{
@@ -139,7 +201,15 @@ static void process_data(struct hup_handle* h)
 		{
 			if (strcmp(cmd->cmd, h->argv[0]) == 0)
 			{
+				HUP_TRACE_CMD(cmd->cmd, 0, h->argc);
+#if CONFIG_HU_PACKET_PROFILE
+				uint32_t start = k_cycle_get_32();
 				cmd->func(h, h->argc, (const char**)h->argv);
+				hupacket_profile(cmd, k_cycle_get_32() - start);
+#else
+				cmd->func(h, h->argc, (const char**)h->argv);
+#endif
+				HUP_TRACE_CMD(cmd->cmd, 1, h->argc);
 				break;
 			}
 		}
@@ -147,6 +217,11 @@ static void process_data(struct hup_handle* h)
 	reset_hupacket(h);
 }
 
+#if CONFIG_SHELL
+SHELL_SUBCMD_SET_CREATE(hup_cmds, (hup));
+SHELL_CMD_REGISTER(hup, &hup_cmds, "hupacket", NULL);
+#endif
+
 void reset_hupacket(void* handle)
 {
 	struct hup_handle* h = handle;
@@ -160,6 +235,7 @@ void reset_hupacket(void* handle)
 void process_hupacket(void* handle, uint8_t* data, size_t data_len)
 {
 	struct hup_handle* h = handle;
+	h->stats->rx_bytes += data_len;
 	while (data_len > 0)
 	{
 		uint8_t ch = *data ++;
@@ -172,6 +248,18 @@ void process_hupacket(void* handle, uint8_t* data, size_t data_len)
 				ch != NAK_OF_RESPONSE)
 				continue;
 		}
+#if CONFIG_HU_PACKET_RS485
+		else if (h->id_pending &&
+			ch != ENQ_OF_COMMAND &&
+			ch != ACK_OF_RESPONSE &&
+			ch != NAK_OF_RESPONSE &&
+			!filter_id(h, ch))
+		{
+			/* skip the rest of the frame up to the next start byte */
+			h->state = HUP_STATE_NONE;
+			continue;
+		}
+#endif
 		switch(ch)
 		{
 		case ENQ_OF_COMMAND:
@@ -181,9 +269,18 @@ void process_hupacket(void* handle, uint8_t* data, size_t data_len)
 			h->state ++;
 			h->response = ch != ENQ_OF_COMMAND;
 			h->argv[h->argc ++] = &h->buffer[h->state];
+#if CONFIG_HU_PACKET_RS485
+			h->id_pending = h->address[0] != '\0';
+			h->broadcast = false;
+#endif
 			break;
 		case END_OF_PACKET:
 			h->buffer[h->state] = '\0';
+#if CONFIG_HU_PACKET_RS485
+			h->eot = k_uptime_ticks();
+#endif
+			h->stats->frames ++;
+			HUP_TRACE("hup_frame", h->state, h->argc);
 			process_data(h);
 			break;
 		case CRC_MARK:
@@ -194,6 +291,7 @@ void process_hupacket(void* handle, uint8_t* data, size_t data_len)
 			}
 			else
 			{
+				h->stats->overflows ++;
 				reset_hupacket(h);
 			}
 			break;
@@ -201,9 +299,14 @@ void process_hupacket(void* handle, uint8_t* data, size_t data_len)
 			h->argv[h->argc ++] = &h->buffer[h->state + 1];
 		default:
 			if (h->state < sizeof(h->buffer))
+			{
 				h->buffer[h->state ++] = ch;
+			}
 			else
+			{
+				h->stats->overflows ++;
 				reset_hupacket(h);
+			}
 			break;
 		}
 	}
@@ -267,7 +370,12 @@ void hupacket_reset_buffer(void* handle, char* buffer, char stx)
 	hupacket_append_char(h, buffer, stx);
 	if (h->id)
 	{
+#if CONFIG_HU_PACKET_RS485
+		/* a broadcast is answered with this node's address so the host can tell the replies apart */
+		hupacket_append_str(h, buffer, h->broadcast ? h->address : h->id);
+#else
 		hupacket_append_str(h, buffer, h->id);
+#endif
 		hupacket_append_char(h, buffer, ID_MARK);
 	}
 	hupacket_append_str(h, buffer, h->argv[0]);
@@ -291,6 +399,7 @@ void hupacket_nak_response(void* h, char* buffer, int rc)
 int hupacket_send_buffer(void* handle, char* buffer)
 {
 	struct hup_handle* h = handle;
+	int ret;
 	if (buffer == NULL)
 		buffer = &h->tx_buffer[0];
 
@@ -302,5 +411,20 @@ int hupacket_send_buffer(void* handle, char* buffer)
 		hupacket_append_hex(h, buffer, crc_calculated);
 	}
 	hupacket_append_char(h, buffer, END_OF_PACKET);
-	return h->send(h->user_data, buffer, strlen(buffer));
+#if CONFIG_HU_PACKET_RS485
+	if (h->broadcast)
+	{
+		/* every node answers a broadcast, each in its own slot after the frame */
+		k_sleep(K_TIMEOUT_ABS_TICKS(h->eot
+			+ k_us_to_ticks_ceil64((uint64_t)h->slot * CONFIG_HU_PACKET_RS485_SLOT_US)));
+	}
+#endif
+	HUP_TRACE("hup_send", strlen(buffer), 0);
+	ret = h->send(h->user_data, buffer, strlen(buffer));
+	HUP_TRACE("hup_send_done", ret, 0);
+	if (ret < 0)
+		h->stats->send_errors ++;
+	else
+		h->stats->tx_bytes += ret;
+	return ret;
 }
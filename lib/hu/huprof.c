@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Command profiler: process_data() times every hup_cmd handler, including
+ * the response it sends. The counters live in a RAM table parallel to the
+ * hup_cmd section, which is in ROM, indexed by the position of the entry.
+ */
+
+#include <hu/hupacket.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/iterable_sections.h>
+#include <zephyr/logging/log.h>
+
+#include <huerrno.h>
+#include <stdio.h>
+#include <string.h>
+
+LOG_MODULE_REGISTER(huprof, CONFIG_LOG_DEFAULT_LEVEL);
+
+#define PROF_BUCKETS	16		// log2 of us: <2, <4, ... , >=32768
+
+struct hup_prof
+{
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t total;
+	uint32_t hist[PROF_BUCKETS];
+};
+
+STRUCT_SECTION_START_EXTERN(hup_cmd);
+
+static struct hup_prof prof[CONFIG_HU_PACKET_PROFILE_CMDS];
+static struct k_spinlock prof_lock;
+
+static inline int _bucket(uint32_t us)
+{
+	int bucket = us > 1 ? 31 - __builtin_clz(us) : 0;
+	return MIN(bucket, PROF_BUCKETS - 1);
+}
+
+void hupacket_profile(const struct hup_cmd* cmd, uint32_t cycles)
+{
+	size_t index = cmd - STRUCT_SECTION_START(hup_cmd);
+	struct hup_prof* p;
+	k_spinlock_key_t key;
+
+	if (index >= ARRAY_SIZE(prof))
+		return;
+
+	p = &prof[index];
+	key = k_spin_lock(&prof_lock);
+	if (p->count == 0 || cycles < p->min)
+		p->min = cycles;
+	if (cycles > p->max)
+		p->max = cycles;
+	p->count ++;
+	p->total += cycles;
+	p->hist[_bucket(k_cyc_to_us_floor32(cycles))] ++;
+	k_spin_unlock(&prof_lock, key);
+}
+
+static void _profile_reset(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&prof_lock);
+	memset(prof, 0, sizeof(prof));
+	k_spin_unlock(&prof_lock, key);
+}
+
+/* "name,count,min,avg,max,h0:h1:..." with times in us, false if it does not fit */
+static bool _profile_format(const struct hup_cmd* cmd, char* buffer, size_t size)
+{
+	size_t index = cmd - STRUCT_SECTION_START(hup_cmd);
+	struct hup_prof p;
+	k_spinlock_key_t key;
+	int len;
+
+	if (index >= ARRAY_SIZE(prof))
+		return false;
+
+	key = k_spin_lock(&prof_lock);
+	p = prof[index];
+	k_spin_unlock(&prof_lock, key);
+
+	len = snprintf(buffer, size, "%s,%u,%u,%u,%u,", cmd->cmd, p.count
+		, k_cyc_to_us_floor32(p.min)
+		, p.count ? (uint32_t)k_cyc_to_us_floor64(p.total / p.count) : 0
+		, k_cyc_to_us_floor32(p.max));
+	for (int i = 0; i < PROF_BUCKETS && len > 0 && (size_t)len < size; i ++)
+		len += snprintf(buffer + len, size - len, i ? ":%u" : "%u", p.hist[i]);
+	return len > 0 && (size_t)len < size;
+}
+
+/* stats [reset]: one record per command that ran, see _profile_format */
+static void _stats(void* h, int argc, const char** argv)
+{
+	struct hup_handle* handle = (struct hup_handle*)h;
+	char record[128];
+
+	hupacket_ack_response(h, NULL);
+	STRUCT_SECTION_FOREACH(hup_cmd, cmd)
+	{
+		size_t index = cmd - STRUCT_SECTION_START(hup_cmd);
+
+		if (index >= ARRAY_SIZE(prof) || prof[index].count == 0)
+			continue;
+		if (!_profile_format(cmd, record, sizeof(record)))
+			continue;
+		/* keep room for the crc and the end of packet */
+		if (strlen(handle->tx_buffer) + strlen(record) + 16 >= sizeof(handle->tx_buffer))
+			break;
+		hupacket_record_str(h, NULL, record);
+	}
+	hupacket_send_buffer(h, NULL);
+
+	if (argc > 1 && strcmp(argv[1], "reset") == 0)
+		_profile_reset();
+}
+DEFINE_HUP_CMD(hup_cmd_stats, "stats", _stats);
+
+#if CONFIG_SHELL
+static int _shell_stats(const struct shell* sh, size_t argc, char** argv)
+{
+	char record[128];
+
+	if (argc > 1 && strcmp(argv[1], "reset") == 0)
+	{
+		_profile_reset();
+		return 0;
+	}
+
+	shell_print(sh, "name,count,min us,avg us,max us,log2 us histogram");
+	STRUCT_SECTION_FOREACH(hup_cmd, cmd)
+	{
+		if (_profile_format(cmd, record, sizeof(record)))
+			shell_print(sh, "%s", record);
+	}
+	return 0;
+}
+SHELL_SUBCMD_ADD((hup), stats, NULL, "Command profile [reset]", _shell_stats, 1, 1);
+#endif
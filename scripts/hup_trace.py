@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2026 HU Inc.
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Latency breakdown of the hupacket pipeline from a CTF trace.
+
+The firmware is built with CONFIG_HU_PACKET_TRACE and a CTF tracing backend,
+see tests/benchmarks/hu/tracing.conf. The trace directory holds the channel files and the
+Zephyr CTF metadata. Reading it needs the babeltrace2 python bindings (bt2).
+
+Stages, in microseconds:
+  rx->recv      first UART byte of a frame to hup_server handing it over
+  recv->frame   last hand over to the end of the frame
+  rx->frame     first UART byte to the end of the frame
+  frame->cmd    end of the frame to the handler start
+  cmd:<name>    handler run time, including its response
+  send          transport send of a response
+  frame->done   end of the frame to the last response sent
+"""
+
+import argparse
+import json
+import sys
+
+try:
+    import bt2
+except ImportError:
+    sys.exit("hup_trace.py needs the babeltrace2 python bindings (bt2)")
+
+
+def named_events(path):
+    """Yield (ns, name, arg0, arg1) for every named event of the trace."""
+    for msg in bt2.TraceCollectionMessageIterator(path):
+        if type(msg) is not bt2._EventMessageConst:
+            continue
+        event = msg.event
+        if event.name != "named_event":
+            continue
+        ns = msg.default_clock_snapshot.ns_from_origin
+        name = str(event.payload_field["name"]).rstrip("\x00")
+        yield ns, name, int(event.payload_field["arg0"]), int(event.payload_field["arg1"])
+
+
+def breakdown(events):
+    stages = {}
+    first_rx = last_recv = frame = cmd_begin = send = None
+
+    def add(stage, begin, end):
+        if begin is not None and end >= begin:
+            stages.setdefault(stage, []).append((end - begin) / 1000.0)
+
+    for ns, name, arg0, _ in events:
+        if name == "hup_uart_rx":
+            if first_rx is None:
+                first_rx = ns
+        elif name == "hup_recv":
+            add("rx->recv", first_rx, ns)
+            last_recv = ns
+        elif name == "hup_frame":
+            add("recv->frame", last_recv, ns)
+            add("rx->frame", first_rx, ns)
+            first_rx = None
+            frame = ns
+        elif name.startswith("cmd:"):
+            if arg0 == 0:
+                add("frame->cmd", frame, ns)
+                cmd_begin = ns
+            else:
+                add(name, cmd_begin, ns)
+                cmd_begin = None
+        elif name == "hup_send":
+            send = ns
+        elif name == "hup_send_done":
+            add("send", send, ns)
+            add("frame->done", frame, ns)
+            send = None
+    return stages
+
+
+def summary(values):
+    values = sorted(values)
+    count = len(values)
+    return {
+        "count": count,
+        "min": values[0],
+        "avg": sum(values) / count,
+        "p50": values[count // 2],
+        "p99": values[min(count - 1, (count * 99) // 100)],
+        "max": values[-1],
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("trace", help="CTF trace directory")
+    parser.add_argument("--json", action="store_true", help="print JSON instead of a table")
+    args = parser.parse_args()
+
+    result = {stage: summary(values) for stage, values in breakdown(named_events(args.trace)).items()}
+    if args.json:
+        print(json.dumps(result, indent=2))
+        return
+
+    print(f"{'stage':<24}{'count':>8}{'min':>10}{'avg':>10}{'p50':>10}{'p99':>10}{'max':>10}")
+    for stage, s in result.items():
+        print(f"{stage:<24}{s['count']:>8}{s['min']:>10.1f}{s['avg']:>10.1f}"
+              f"{s['p50']:>10.1f}{s['p99']:>10.1f}{s['max']:>10.1f}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,17 @@
+# Copyright (c) 2026 HU Inc.
+# SPDX-License-Identifier: Apache-2.0
+
+# Included by the tests/app suites after project(): builds src/main.c of
+# the suite with the given app/src sources, on their own without the rest
+# of the app, and adds the shared test headers.
+
+set(APP_TEST_COMMON_DIR ${CMAKE_CURRENT_LIST_DIR})
+set(APP_TEST_SOURCE_DIR ${CMAKE_CURRENT_LIST_DIR}/../../../app/src)
+
+function(app_test_sources)
+  target_sources(app PRIVATE src/main.c)
+  foreach(source ${ARGN})
+    target_sources(app PRIVATE ${APP_TEST_SOURCE_DIR}/${source})
+  endforeach()
+  target_include_directories(app PRIVATE ${APP_TEST_COMMON_DIR}/include)
+endfunction()
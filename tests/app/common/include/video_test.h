@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __VIDEO_TEST_H__
+#define __VIDEO_TEST_H__
+
+#include <zephyr/drivers/video.h>
+
+/* packed frame of the given format, as the camera service gets it */
+static inline struct video_format _fmt(uint32_t pixelformat, int width, int height)
+{
+	return (struct video_format){
+		.pixelformat = pixelformat,
+		.width = width,
+		.height = height,
+		.pitch = width * video_bits_per_pixel(pixelformat) / BITS_PER_BYTE,
+	};
+}
+
+#endif // __VIDEO_TEST_H__
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file software path of the camera conversion stage
+ *
+ * Every input pixel of the RGB565 frames holds its own index, so a wrong
+ * rotation or scaling shows up as a wrong value. The expected output is
+ * computed here pixel by pixel, independently of the tiled walk.
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/drivers/video.h>
+
+#include <app/vconvert.h>
+#include <video_test.h>
+
+#include <errno.h>
+#include <string.h>
+
+#define IN_W		16
+#define IN_H		8
+#define OUT_MAX		(IN_W * 2 * IN_H * 2)		// twice upscaled
+
+static uint16_t src[IN_W * IN_H];
+static uint16_t dst[OUT_MAX];
+static uint16_t ref[OUT_MAX];
+
+/* nearest neighbour sampling at the centre of the output pixel */
+static int _sample(int pos, int out_size, int in_size)
+{
+	return (2 * pos + 1) * in_size / (2 * out_size);
+}
+
+/* expected RGB565 output of the indexed source for a clockwise rotation */
+static void _reference(int out_w, int out_h, int rotation)
+{
+	bool swap = rotation == 90 || rotation == 270;
+	int uw = swap ? out_h : out_w;
+	int uh = swap ? out_w : out_h;
+
+	for (int y = 0; y < out_h; y ++)
+	{
+		for (int x = 0; x < out_w; x ++)
+		{
+			int ux, uy;
+
+			switch (rotation)
+			{
+			case 90:	ux = y;				uy = uh - 1 - x;	break;
+			case 180:	ux = uw - 1 - x;	uy = uh - 1 - y;	break;
+			case 270:	ux = uw - 1 - y;	uy = x;				break;
+			default:	ux = x;				uy = y;				break;
+			}
+			ref[y * out_w + x] = src[_sample(uy, uh, IN_H) * IN_W + _sample(ux, uw, IN_W)];
+		}
+	}
+}
+
+static void _check(int out_w, int out_h, int rotation)
+{
+	struct video_format in = _fmt(VIDEO_PIX_FMT_RGB565, IN_W, IN_H);
+	struct video_format out = _fmt(VIDEO_PIX_FMT_RGB565, out_w, out_h);
+	int err;
+
+	memset(dst, 0xaa, sizeof(dst));
+	err = vconvert(&in, (const uint8_t*)src, &out, (uint8_t*)dst, rotation);
+	zassert_equal(err, 0, "%dx%d rotation %d failed %d", out_w, out_h, rotation, err);
+
+	_reference(out_w, out_h, rotation);
+	for (int i = 0; i < out_w * out_h; i ++)
+		zassert_equal(dst[i], ref[i], "%dx%d rotation %d: pixel (%d, %d) is %04x, not %04x"
+			, out_w, out_h, rotation, i % out_w, i / out_w, dst[i], ref[i]);
+}
+
+static void* _setup(void)
+{
+	init_vconvert();
+	for (int i = 0; i < ARRAY_SIZE(src); i ++)
+		src[i] = i;
+	return NULL;
+}
+
+ZTEST(vconvert, test_copy)
+{
+	_check(IN_W, IN_H, 0);
+}
+
+ZTEST(vconvert, test_rotate)
+{
+	_check(IN_H, IN_W, 90);
+	_check(IN_W, IN_H, 180);
+	_check(IN_H, IN_W, 270);
+}
+
+ZTEST(vconvert, test_scale)
+{
+	_check(IN_W / 2, IN_H / 2, 0);
+	_check(IN_H / 2, IN_W / 2, 90);
+	_check(IN_W / 2, IN_H / 2, 180);
+	_check(IN_H / 2, IN_W / 2, 270);
+	/* upscaling repeats source pixels */
+	_check(IN_W * 2, IN_H * 2, 0);
+}
+
+ZTEST(vconvert, test_rgb24)
+{
+	static const uint8_t rgb[] = {
+		255, 0, 0,		0, 255, 0,		0, 0, 255,		255, 255, 255,
+	};
+	static const uint16_t expected[] = { 0xf800, 0x07e0, 0x001f, 0xffff };
+	struct video_format in = _fmt(VIDEO_PIX_FMT_RGB24, 4, 1);
+	struct video_format out = _fmt(VIDEO_PIX_FMT_RGB565, 4, 1);
+
+	zassert_equal(vconvert(&in, rgb, &out, (uint8_t*)dst, 0), 0);
+	zassert_mem_equal(dst, expected, sizeof(expected));
+}
+
+ZTEST(vconvert, test_yuyv)
+{
+	/* BT.601 limited range: white and black, then red and blue sharing chroma per pair */
+	static const uint8_t yuyv[] = {
+		235, 128, 16, 128,
+		81, 90, 81, 240,
+		41, 240, 41, 110,
+	};
+	static const uint16_t expected[] = { 0xffff, 0x0000, 0xf800, 0xf800, 0x001f, 0x001f };
+	struct video_format in = _fmt(VIDEO_PIX_FMT_YUYV, 6, 1);
+	struct video_format out = _fmt(VIDEO_PIX_FMT_RGB565, 6, 1);
+
+	zassert_equal(vconvert(&in, yuyv, &out, (uint8_t*)dst, 0), 0);
+	zassert_mem_equal(dst, expected, sizeof(expected));
+}
+
+ZTEST(vconvert, test_errors)
+{
+	struct video_format in = _fmt(VIDEO_PIX_FMT_RGB565, IN_W, IN_H);
+	struct video_format out = _fmt(VIDEO_PIX_FMT_RGB565, IN_W, IN_H);
+	struct video_format grey = _fmt(VIDEO_PIX_FMT_GREY, IN_W, IN_H);
+	struct video_format big = _fmt(VIDEO_PIX_FMT_RGB565, CONFIG_VIDEO_CONVERT_MAX_SIZE + 1, 1);
+
+	zassert_equal(vconvert(&in, (const uint8_t*)src, &out, (uint8_t*)dst, 45), -EINVAL);
+	zassert_equal(vconvert(&grey, (const uint8_t*)src, &out, (uint8_t*)dst, 0), -ENOTSUP);
+	zassert_equal(vconvert(&in, (const uint8_t*)src, &grey, (uint8_t*)dst, 0), -ENOTSUP);
+	zassert_equal(vconvert(&in, (const uint8_t*)src, &big, (uint8_t*)dst, 0), -EINVAL);
+}
+
+ZTEST_SUITE(vconvert, NULL, _setup, NULL, NULL, NULL);
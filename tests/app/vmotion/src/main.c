@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file motion detection of the camera service
+ *
+ * The block kernel of the target, Helium, DSP or SWAR, and the SWAR one
+ * are checked against a plain sum of absolute differences. Frames are
+ * flat with a changed rectangle, so the changed blocks are known exactly.
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/drivers/video.h>
+
+#include <app/vmotion.h>
+#include <video_test.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCK_SIZE	64
+#define FRAME_W		64
+#define FRAME_H		64			// 4 x 4 blocks sampled every 2 pixels
+#define FRAME_MAX	(FRAME_W * FRAME_H * 2)
+
+/* built by vmotion.c with CONFIG_ZTEST */
+uint32_t vmotion_sad(const uint8_t* a, const uint8_t* b);
+uint32_t vmotion_sad_swar(const uint8_t* a, const uint8_t* b);
+
+static uint8_t block_a[BLOCK_SIZE] __aligned(16);
+static uint8_t block_b[BLOCK_SIZE] __aligned(16);
+static uint8_t frame[FRAME_MAX] __aligned(4);
+
+static uint32_t _reference(const uint8_t* a, const uint8_t* b)
+{
+	uint32_t sad = 0;
+
+	for (int i = 0; i < BLOCK_SIZE; i ++)
+		sad += abs(a[i] - b[i]);
+	return sad;
+}
+
+static void _check_sad(void)
+{
+	uint32_t expected = _reference(block_a, block_b);
+
+	zassert_equal(vmotion_sad(block_a, block_b), expected);
+	zassert_equal(vmotion_sad_swar(block_a, block_b), expected);
+}
+
+/* value everywhere, changed inside the rectangle */
+static void _fill(const struct video_format* fmt, uint16_t value, uint16_t changed
+	, int x0, int y0, int w, int h)
+{
+	for (int y = 0; y < fmt->height; y ++)
+	{
+		uint8_t* row = frame + y * fmt->pitch;
+
+		for (int x = 0; x < fmt->width; x ++)
+		{
+			bool inside = x >= x0 && x < x0 + w && y >= y0 && y < y0 + h;
+			uint16_t v = inside ? changed : value;
+
+			switch (fmt->pixelformat)
+			{
+			case VIDEO_PIX_FMT_YUYV:
+				row[x * 2] = v;
+				row[x * 2 + 1] = 128;
+				break;
+			case VIDEO_PIX_FMT_RGB565:
+				((uint16_t*)row)[x] = v;
+				break;
+			default:
+				row[x] = v;
+				break;
+			}
+		}
+	}
+}
+
+/* a reference frame, then the changed one, returns its changed blocks */
+static int _process(const struct video_format* fmt, uint16_t value, uint16_t changed
+	, int x0, int y0, int w, int h)
+{
+	int err;
+
+	_fill(fmt, value, value, 0, 0, 0, 0);
+	err = vmotion_process(fmt, frame, 1);
+	zassert_true(err >= 0, "reference frame failed %d", err);
+	_fill(fmt, value, changed, x0, y0, w, h);
+	return vmotion_process(fmt, frame, 2);
+}
+
+static void _before(void* fixture)
+{
+	struct video_format small = _fmt(VIDEO_PIX_FMT_GREY, 16, 16);
+
+	ARG_UNUSED(fixture);
+	vmotion_config(CONFIG_VIDEO_MOTION_THRESHOLD, CONFIG_VIDEO_MOTION_MIN_BLOCKS);
+	/* a different block count, the next frame is not compared */
+	memset(frame, 0, sizeof(frame));
+	zassert_equal(vmotion_process(&small, frame, 0), 0);
+}
+
+ZTEST(vmotion, test_sad_kernels)
+{
+	uint32_t seed = 12345;
+
+#if defined(__ARM_FEATURE_MVE)
+	TC_PRINT("Helium kernel\n");
+#elif defined(__ARM_FEATURE_SIMD32)
+	TC_PRINT("DSP kernel\n");
+#else
+	TC_PRINT("SWAR kernel\n");
+#endif
+
+	memset(block_a, 0, sizeof(block_a));
+	memset(block_b, 0, sizeof(block_b));
+	_check_sad();
+
+	/* the largest sum, every lane borrows */
+	memset(block_b, 0xff, sizeof(block_b));
+	_check_sad();
+	zassert_equal(vmotion_sad(block_b, block_a), 255 * BLOCK_SIZE);
+
+	for (int i = 0; i < BLOCK_SIZE; i ++)
+		block_a[i] = i & 1 ? 0xff : 0;
+	_check_sad();
+
+	for (int n = 0; n < 1000; n ++)
+	{
+		for (int i = 0; i < BLOCK_SIZE; i ++)
+		{
+			seed = seed * 1103515245 + 12345;
+			block_a[i] = seed >> 24;
+			/* near values in half of the blocks, a difference of 0 or 1 */
+			block_b[i] = n & 1 ? block_a[i] + ((seed >> 16) & 1) : seed >> 16;
+		}
+		_check_sad();
+	}
+}
+
+ZTEST(vmotion, test_unchanged)
+{
+	struct video_format fmt = _fmt(VIDEO_PIX_FMT_GREY, FRAME_W, FRAME_H);
+
+	zassert_equal(_process(&fmt, 100, 100, 0, 0, 0, 0), 0);
+	zassert_equal(vmotion_process(&fmt, frame, 3), 0);
+}
+
+ZTEST(vmotion, test_changed_blocks)
+{
+	struct video_format fmt = _fmt(VIDEO_PIX_FMT_GREY, FRAME_W, FRAME_H);
+
+	/* blocks are 16 x 16 pixels of the frame */
+	zassert_equal(_process(&fmt, 100, 200, 0, 0, 32, 32), 4);
+	zassert_equal(_process(&fmt, 100, 0, 16, 16, 16, 16), 1);
+	zassert_equal(_process(&fmt, 100, 200, 0, 0, FRAME_W, FRAME_H), 16);
+	/* half of the samples of two blocks */
+	zassert_equal(_process(&fmt, 100, 200, 0, 48, 32, 8), 2);
+}
+
+ZTEST(vmotion, test_threshold)
+{
+	struct video_format fmt = _fmt(VIDEO_PIX_FMT_GREY, FRAME_W, FRAME_H);
+	int threshold = CONFIG_VIDEO_MOTION_THRESHOLD;
+
+	/* a block changes when its mean difference is over the threshold */
+	zassert_equal(_process(&fmt, 100, 100 + threshold, 0, 0, 32, 32), 0);
+	zassert_equal(_process(&fmt, 100, 100 - threshold - 1, 0, 0, 32, 32), 4);
+
+	vmotion_config(50, 1);
+	zassert_equal(_process(&fmt, 100, 150, 0, 0, 32, 32), 0);
+	zassert_equal(_process(&fmt, 100, 151, 0, 0, 32, 32), 4);
+}
+
+ZTEST(vmotion, test_formats)
+{
+	struct video_format yuyv = _fmt(VIDEO_PIX_FMT_YUYV, FRAME_W, FRAME_H);
+	struct video_format rgb565 = _fmt(VIDEO_PIX_FMT_RGB565, FRAME_W, FRAME_H);
+
+	zassert_equal(_process(&yuyv, 100, 200, 32, 32, 32, 32), 4);
+	zassert_equal(_process(&rgb565, 0x0000, 0xffff, 32, 0, 32, 32), 4);
+	/* pure red and green differ in luma */
+	zassert_equal(_process(&rgb565, 0xf800, 0x07e0, 0, 0, 16, 64), 4);
+}
+
+ZTEST(vmotion, test_events)
+{
+	struct video_format fmt = _fmt(VIDEO_PIX_FMT_GREY, FRAME_W, FRAME_H);
+	struct vmotion_event event;
+	uint32_t seen = vmotion_events();
+
+	zassert_equal(vmotion_wait(&seen, &event, K_NO_WAIT), -EAGAIN);
+
+	/* below min blocks, no event */
+	zassert_equal(_process(&fmt, 100, 200, 0, 0, 16, 48), 3);
+	zassert_equal(vmotion_wait(&seen, &event, K_NO_WAIT), -EAGAIN);
+
+	/* two events before the caller looks, the latest one is returned */
+	zassert_equal(_process(&fmt, 100, 200, 0, 0, 32, 32), 4);
+	zassert_equal(_process(&fmt, 100, 200, 0, 0, FRAME_W, FRAME_H), 16);
+	zassert_equal(vmotion_wait(&seen, &event, K_NO_WAIT), 0);
+	zassert_equal(event.timestamp, 2);
+	zassert_equal(event.blocks, 16);
+	zassert_equal(event.total, 16);
+	zassert_equal(seen, vmotion_events());
+
+	/* nothing new since */
+	zassert_equal(vmotion_wait(&seen, &event, K_MSEC(10)), -EAGAIN);
+	zassert_equal(vmotion_wait(NULL, &event, K_NO_WAIT), -EAGAIN);
+}
+
+ZTEST(vmotion, test_errors)
+{
+	struct video_format fmt = _fmt(VIDEO_PIX_FMT_RGB24, FRAME_W, FRAME_H);
+
+	zassert_equal(vmotion_process(&fmt, frame, 0), -ENOTSUP);
+
+	/* smaller than a block and more blocks than kept */
+	fmt = _fmt(VIDEO_PIX_FMT_GREY, 8, 8);
+	zassert_equal(vmotion_process(&fmt, frame, 0), -EINVAL);
+	fmt = _fmt(VIDEO_PIX_FMT_GREY, FRAME_W * 2, FRAME_H);
+	zassert_equal(vmotion_process(&fmt, frame, 0), -EINVAL);
+}
+
+ZTEST_SUITE(vmotion, NULL, NULL, _before, NULL, NULL);
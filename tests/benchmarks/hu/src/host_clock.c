@@ -0,0 +1,18 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* built for the host side of native_sim, see CMakeLists.txt */
+
+#include <stdint.h>
+#include <time.h>
+
+uint64_t hu_bench_host_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file microbenchmarks of the hu library
+ *
+ * Every benchmark prints one line "hu_bench: {json}" with the iterations,
+ * bytes, elapsed ns, ns per operation and bytes per second, so runs can be
+ * compared per commit. Twister records them from testcase.yaml.
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/crc.h>
+
+#include <hu/hupacket.h>
+#include <hu/ascii85.h>
+#include <hu/palloc.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define CHUNK_SIZE			256		// binary size of a flash chunk
+#define STREAM_FRAMES		16
+#define STREAM_ITERATIONS	200
+#define FEED_SIZE			64		// bytes per process_hupacket() call, like a UART read
+#define DISPATCH_FRAMES		64
+#define DISPATCH_ITERATIONS	100
+#define ASCII85_ITERATIONS	2000
+#define CRC_SIZE			1024
+#define CRC_ITERATIONS		2000
+#define PALLOC_BLOCKS		8
+#define PALLOC_ITERATIONS	2000
+
+#if CONFIG_NATIVE_LIBRARY
+/* the code runs in zero simulated time on native_sim, use the host clock */
+extern uint64_t hu_bench_host_ns(void);
+
+static inline uint64_t _stamp(void)
+{
+	return hu_bench_host_ns();
+}
+
+static inline uint64_t _elapsed_ns(uint64_t start)
+{
+	return hu_bench_host_ns() - start;
+}
+#else
+static inline uint64_t _stamp(void)
+{
+	return k_cycle_get_32();
+}
+
+static inline uint64_t _elapsed_ns(uint64_t start)
+{
+	return k_cyc_to_ns_floor64((uint32_t)(k_cycle_get_32() - (uint32_t)start));
+}
+#endif
+
+static void _report(const char* name, uint32_t ops, uint64_t bytes, uint64_t ns)
+{
+	if (ns == 0)
+		ns = 1;
+	printk("hu_bench: {\"name\":\"%s\",\"board\":\"%s\",\"iterations\":%u,\"bytes\":%llu"
+		",\"ns\":%llu,\"ns_per_op\":%llu,\"bytes_per_s\":%llu}\n"
+		, name, CONFIG_BOARD, ops, bytes, ns, ns / ops, bytes * 1000000000ULL / ns);
+}
+
+/* deterministic filler, runs stay comparable and no entropy driver is needed */
+static void _fill(uint8_t* data, size_t size)
+{
+	uint32_t seed = 0x12345678;
+
+	for (size_t i = 0; i < size; i ++)
+	{
+		seed = seed * 1103515245 + 12345;
+		data[i] = seed >> 24;
+	}
+}
+
+static uint32_t bench_calls;
+static uint32_t bench_crc_errors;
+
+static void _bench(void* h, int argc, const char** argv)
+{
+	struct hup_handle* handle = h;
+
+	bench_calls ++;
+	if (handle->crc16 != NULL && !handle->crc_match)
+		bench_crc_errors ++;
+}
+DEFINE_HUP_CMD(hup_cmd_bench, "bench", _bench);
+
+static ssize_t _send(void* user_data, const uint8_t* buffer, size_t size)
+{
+	return size;
+}
+
+static void* hup;
+static uint8_t chunk[CHUNK_SIZE];
+static char stream[STREAM_FRAMES * (CHUNK_SIZE * 5 / 4 + 64)];
+static size_t stream_len;
+
+#if CONFIG_HU_PALLOC_POOL
+static uint8_t pool[32 * 1024] __aligned(8);
+#endif
+
+/* flash shaped frames: partition, offset, length, ascii85 chunk, optional crc */
+static size_t _build_stream(bool crc)
+{
+	char* ptr = stream;
+
+	for (int i = 0; i < STREAM_FRAMES; i ++)
+	{
+		char* start;
+		int len;
+
+		*ptr ++ = 0x05;
+		start = ptr;
+		ptr += sprintf(ptr, "bench:%d\x1eslot1\x1e%x\x1e%x\x1e", i, i * CHUNK_SIZE, CHUNK_SIZE);
+		len = encode_ascii85(chunk, sizeof(chunk), (uint8_t*)ptr, stream + sizeof(stream) - ptr);
+		zassert_true(len > 0, "ascii85 encode failed %d", len);
+		ptr += len;
+		if (crc)
+		{
+			uint16_t value = crc16(CRC16_CCITT_POLY, 0x0000, start, ptr - start);
+			ptr += sprintf(ptr, "\x1a%x", value);
+		}
+		*ptr ++ = 0x04;
+	}
+	return ptr - stream;
+}
+
+static void _bench_stream(const char* name, bool crc)
+{
+	uint64_t start, ns;
+
+	stream_len = _build_stream(crc);
+	bench_calls = 0;
+	bench_crc_errors = 0;
+
+	start = _stamp();
+	for (int i = 0; i < STREAM_ITERATIONS; i ++)
+	{
+		for (size_t offset = 0; offset < stream_len; offset += FEED_SIZE)
+			process_hupacket(hup, (uint8_t*)stream + offset, MIN(FEED_SIZE, stream_len - offset));
+	}
+	ns = _elapsed_ns(start);
+
+	zassert_equal(bench_calls, STREAM_FRAMES * STREAM_ITERATIONS, "lost frames %u", bench_calls);
+	zassert_equal(bench_crc_errors, 0, "crc errors %u", bench_crc_errors);
+	_report(name, bench_calls, (uint64_t)stream_len * STREAM_ITERATIONS, ns);
+}
+
+ZTEST(hu_bench, test_process_hupacket_stream)
+{
+	_bench_stream("process_hupacket", false);
+}
+
+ZTEST(hu_bench, test_process_hupacket_stream_crc)
+{
+	_bench_stream("process_hupacket_crc", true);
+}
+
+ZTEST(hu_bench, test_dispatch)
+{
+	static const char frame[] = "\x05" "bench" "\x04";
+	uint64_t start, ns;
+	char* ptr = stream;
+
+	for (int i = 0; i < DISPATCH_FRAMES; i ++, ptr += sizeof(frame) - 1)
+		memcpy(ptr, frame, sizeof(frame) - 1);
+	stream_len = ptr - stream;
+	bench_calls = 0;
+
+	start = _stamp();
+	for (int i = 0; i < DISPATCH_ITERATIONS; i ++)
+		process_hupacket(hup, (uint8_t*)stream, stream_len);
+	ns = _elapsed_ns(start);
+
+	zassert_equal(bench_calls, DISPATCH_FRAMES * DISPATCH_ITERATIONS, "lost frames %u", bench_calls);
+	_report("dispatch", bench_calls, (uint64_t)stream_len * DISPATCH_ITERATIONS, ns);
+}
+
+ZTEST(hu_bench, test_ascii85)
+{
+	static uint8_t encoded[CHUNK_SIZE * 5 / 4 + 8];
+	static uint8_t decoded[CHUNK_SIZE];
+	uint64_t start, ns;
+	int len = 0;
+
+	start = _stamp();
+	for (int i = 0; i < ASCII85_ITERATIONS; i ++)
+		len = encode_ascii85(chunk, sizeof(chunk), encoded, sizeof(encoded));
+	ns = _elapsed_ns(start);
+	zassert_true(len > 0, "ascii85 encode failed %d", len);
+	_report("ascii85_encode", ASCII85_ITERATIONS, (uint64_t)sizeof(chunk) * ASCII85_ITERATIONS, ns);
+
+	start = _stamp();
+	for (int i = 0; i < ASCII85_ITERATIONS; i ++)
+		decode_ascii85(encoded, len, decoded, sizeof(decoded));
+	ns = _elapsed_ns(start);
+	zassert_mem_equal(decoded, chunk, sizeof(chunk), "ascii85 round trip failed");
+	_report("ascii85_decode", ASCII85_ITERATIONS, (uint64_t)sizeof(chunk) * ASCII85_ITERATIONS, ns);
+}
+
+ZTEST(hu_bench, test_crc16)
+{
+	static uint8_t data[CRC_SIZE];
+	volatile uint16_t value = 0;
+	uint64_t start, ns;
+
+	_fill(data, sizeof(data));
+	start = _stamp();
+	for (int i = 0; i < CRC_ITERATIONS; i ++)
+		value += crc16(CRC16_CCITT_POLY, 0x0000, data, sizeof(data));
+	ns = _elapsed_ns(start);
+	(void)value;
+	_report("crc16", CRC_ITERATIONS, (uint64_t)sizeof(data) * CRC_ITERATIONS, ns);
+}
+
+ZTEST(hu_bench, test_palloc)
+{
+	static const size_t sizes[PALLOC_BLOCKS] = { 16, 1024, 64, 256, 32, 512, 128, 48 };
+	void* blocks[PALLOC_BLOCKS];
+	uint64_t start, ns;
+
+	start = _stamp();
+	for (int i = 0; i < PALLOC_ITERATIONS; i ++)
+	{
+		for (int b = 0; b < PALLOC_BLOCKS; b ++)
+			blocks[b] = palloc(sizes[b]);
+		/* free out of order so the free list has to merge */
+		for (int b = 1; b < PALLOC_BLOCKS; b += 2)
+			pfree(blocks[b]);
+		for (int b = 0; b < PALLOC_BLOCKS; b += 2)
+			pfree(blocks[b]);
+	}
+	ns = _elapsed_ns(start);
+
+	zassert_not_null(blocks[0], "palloc failed");
+	_report(IS_ENABLED(CONFIG_HU_PALLOC_POOL) ? "palloc_pool" : "palloc_malloc"
+		, PALLOC_ITERATIONS * PALLOC_BLOCKS, 0, ns);
+}
+
+static void* _setup(void)
+{
+#if CONFIG_HU_PALLOC_POOL
+	palloc_init(pool, pool + sizeof(pool));
+#endif
+	_fill(chunk, sizeof(chunk));
+	hup = init_hupacket(NULL, _send, NULL);
+	zassert_not_null(hup, "no memory for the parser");
+	return NULL;
+}
+
+static void _teardown(void* fixture)
+{
+	deinit_hupacket(hup);
+}
+
+ZTEST_SUITE(hu_bench, NULL, _setup, NULL, NULL, _teardown);
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2026 HU Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file multicast flash sessions on the native_sim flash simulator
+ *
+ * An image is sent with mflash while some chunks are lost, then the chunks
+ * mstatus reports missing are repaired with unicast flash commands, the
+ * short last chunk of the image included.
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/storage/flash_map.h>
+
+#include <hu/hupacket.h>
+#include <hu/ascii85.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define CHUNK		200			// not over 256, rejected by flash before
+#define IMAGE_SIZE	(CHUNK * 2 + 130)
+#define CHUNKS		3
+
+static void* hup;
+static uint8_t image[IMAGE_SIZE];
+static uint8_t readback[IMAGE_SIZE];
+static char frame[CONFIG_HU_PACKET_SIZE];
+static char reply[CONFIG_HU_PACKET_SIZE];
+
+static ssize_t _send(void* user_data, const uint8_t* buffer, size_t size)
+{
+	size = MIN(size, sizeof(reply) - 1);
+	memcpy(reply, buffer, size);
+	reply[size] = '\0';
+	return size;
+}
+
+/* one frame of fields separated by record marks, the reply lands in reply */
+static void _command(const char* fields, const uint8_t* data, size_t size)
+{
+	char* ptr = frame;
+	int len;
+
+	reply[0] = '\0';
+	*ptr ++ = 0x05;
+	ptr += sprintf(ptr, "%s", fields);
+	if (data != NULL)
+	{
+		*ptr ++ = 0x1e;
+		len = encode_ascii85(data, size, (uint8_t*)ptr, frame + sizeof(frame) - 1 - ptr);
+		zassert_true(len > 0, "ascii85 encode failed %d", len);
+		ptr += len;
+	}
+	*ptr ++ = 0x04;
+	process_hupacket(hup, (uint8_t*)frame, ptr - frame);
+}
+
+static void _mflash(int index)
+{
+	char fields[32];
+	uint32_t offset = index * CHUNK;
+	uint32_t size = MIN(CHUNK, IMAGE_SIZE - offset);
+
+	snprintf(fields, sizeof(fields), "mflash\x1e%x\x1e%x", offset, size);
+	_command(fields, image + offset, size);
+	zassert_equal(reply[0], '\0', "mflash answered");
+}
+
+static void _flash(int index)
+{
+	char fields[48];
+	uint32_t offset = index * CHUNK;
+	uint32_t size = MIN(CHUNK, IMAGE_SIZE - offset);
+
+	snprintf(fields, sizeof(fields), "flash\x1eslot1\x1e%x\x1e%x", offset, size);
+	_command(fields, image + offset, size);
+	zassert_not_null(strstr(reply, "flash\x1e" "0\x1e"), "flash of chunk %d failed: %s", index, reply);
+}
+
+static void _expect_status(const char* expected)
+{
+	_command("mstatus", NULL, 0);
+	zassert_not_null(strstr(reply, expected), "mstatus %s, expected %s", reply, expected);
+}
+
+ZTEST(huflash, test_repair_short_last_chunk)
+{
+	const struct flash_area* fa;
+	char fields[48];
+
+	_command("erase\x1eslot1", NULL, 0);
+	zassert_not_null(strstr(reply, "erase\x1e" "0\x1e"), "erase failed: %s", reply);
+
+	snprintf(fields, sizeof(fields), "mbegin\x1eslot1\x1e%x\x1e%x", IMAGE_SIZE, CHUNK);
+	_command(fields, NULL, 0);
+	zassert_not_null(strstr(reply, "mbegin\x1e" "0\x1e" "3\x1e"), "mbegin failed: %s", reply);
+
+	/* the middle and the short last chunk are lost */
+	_mflash(0);
+	_expect_status("mstatus\x1e" "0\x1e" "1\x1e" "3\x1e" "1-2");
+
+	_flash(1);
+	_expect_status("mstatus\x1e" "0\x1e" "2\x1e" "3\x1e" "2-2");
+	_flash(2);
+	_expect_status("mstatus\x1e" "0\x1e" "3\x1e" "3\x04");
+
+	_command("mend", NULL, 0);
+	zassert_not_null(strstr(reply, "mend\x1e" "0"), "mend failed: %s", reply);
+
+	zassert_ok(flash_area_open(FIXED_PARTITION_ID(slot1_partition), &fa));
+	zassert_ok(flash_area_read(fa, 0, readback, sizeof(readback)));
+	flash_area_close(fa);
+	zassert_mem_equal(readback, image, sizeof(image), "image differs");
+}
+
+ZTEST(huflash, test_flash_sizes)
+{
+	char fields[48];
+
+	/* a length the decode buffer cannot hold */
+	snprintf(fields, sizeof(fields), "flash\x1eslot1\x1e%x\x1e%x", 0, CONFIG_HU_PACKET_SIZE + 1);
+	_command(fields, image, 4);
+	zassert_is_null(strstr(reply, "flash\x1e" "0\x1e"), "oversized flash accepted: %s", reply);
+
+	snprintf(fields, sizeof(fields), "flash\x1eslot1\x1e%x\x1e%x", 0, 0);
+	_command(fields, image, 4);
+	zassert_is_null(strstr(reply, "flash\x1e" "0\x1e"), "empty flash accepted: %s", reply);
+}
+
+static void* _setup(void)
+{
+	uint32_t seed = 0x12345678;
+
+	for (size_t i = 0; i < sizeof(image); i ++)
+	{
+		seed = seed * 1103515245 + 12345;
+		image[i] = seed >> 24;
+	}
+	hup = init_hupacket(NULL, _send, NULL);
+	zassert_not_null(hup, "no memory for the parser");
+	return NULL;
+}
+
+static void _teardown(void* fixture)
+{
+	deinit_hupacket(hup);
+}
+
+ZTEST_SUITE(huflash, NULL, _setup, NULL, NULL, _teardown);